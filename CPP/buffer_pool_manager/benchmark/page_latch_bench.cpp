@@ -0,0 +1,98 @@
+/**
+ * Microbenchmark of PageLatch against a std::shared_mutex based latch, the one ReaderWriterLatch wraps.
+ *
+ * Every thread repeatedly takes the latch, shared with the given probability and exclusive otherwise, around a
+ * critical section as short as a page latch typically guards: reading or bumping a few words on one cache line.
+ * The output is the throughput of both latches for each read ratio and thread count, in million acquisitions per
+ * second.
+ *
+ * Usage: page_latch_bench [milliseconds per run]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <shared_mutex>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "page_latch.h"
+
+namespace {
+
+/** The baseline, with the same interface as PageLatch. */
+class SharedMutexLatch {
+ public:
+  void WLock() { mutex_.lock(); }
+  void WUnlock() { mutex_.unlock(); }
+  void RLock() { mutex_.lock_shared(); }
+  void RUnlock() { mutex_.unlock_shared(); }
+
+ private:
+  std::shared_mutex mutex_;
+};
+
+constexpr int WORDS = 8;
+
+template <class Latch>
+auto Run(int read_percent, int num_threads, std::chrono::milliseconds duration) -> double {
+  Latch latch;
+  alignas(64) uint64_t words[WORDS] = {};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> torn{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      uint32_t rng = 2654435761U * static_cast<uint32_t>(t + 1);
+      uint64_t ops = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        rng = rng * 1103515245U + 12345U;
+        if ((rng >> 16) % 100 < static_cast<uint32_t>(read_percent)) {
+          latch.RLock();
+          // Writers bump every word, so a consistent read sees them all equal
+          if (words[0] != words[WORDS - 1]) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+          }
+          latch.RUnlock();
+        } else {
+          latch.WLock();
+          for (auto &word : words) {
+            word += 1;
+          }
+          latch.WUnlock();
+        }
+        ops += 1;
+      }
+      total += ops;
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (torn != 0) {
+    fprintf(stderr, "latch let a reader in during a write\n");
+    exit(1);
+  }
+  return static_cast<double>(total) / std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+  std::chrono::milliseconds duration{argc > 1 ? atoi(argv[1]) : 1000};
+  int max_threads = static_cast<int>(std::max(4U, 2 * std::thread::hardware_concurrency()));
+  printf("%-8s %-8s %12s %12s\n", "reads", "threads", "PageLatch", "shared_mutex");
+  for (int read_percent : {50, 95, 100}) {
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+      double page_latch = Run<PageLatch>(read_percent, num_threads, duration);
+      double shared_mutex = Run<SharedMutexLatch>(read_percent, num_threads, duration);
+      printf("%-8d %-8d %12.2f %12.2f\n", read_percent, num_threads, page_latch, shared_mutex);
+    }
+  }
+  return 0;
+}
@@ -1,180 +1,1079 @@
 #include "buffer_pool_manager.h"
 #include "page_guard.h"
 
+#include <algorithm>
+#include <thread>  // NOLINT
+
+namespace {
+
+/** Hands out pool serial numbers, 0 marks a free pin cache entry. */
+std::atomic<uint64_t> next_pool_serial{1};
+
+/**
+ * Pools with the pin cache enabled, by serial number, so that a thread exiting late can tell if they are gone. The
+ * latch also protects the list of every thread's pin cache, which lets a pool drain the pins parked in them.
+ */
+std::mutex live_pools_latch;
+std::unordered_map<uint64_t, BufferPoolManager *> live_pools;
+std::vector<ThreadPinCache *> pin_caches;
+
+}  // namespace
+
+struct BufferPoolManager::LocalPinCache {
+  ThreadPinCache cache_;
+
+  LocalPinCache() {
+    std::scoped_lock scoped_lock(live_pools_latch);
+    pin_caches.push_back(&cache_);
+  }
+
+  ~LocalPinCache() {
+    // The registry latch also keeps the pools from being destroyed while we release into them
+    std::scoped_lock scoped_lock(live_pools_latch);
+    pin_caches.erase(std::find(pin_caches.begin(), pin_caches.end(), &cache_));
+    for (const auto &entry : cache_.RemoveAll()) {
+      auto it = live_pools.find(entry.pool_);
+      if (it != live_pools.end()) {
+        it->second->ReleasePins(entry.page_id_, entry.pins_);
+      }
+    }
+  }
+};
+
 BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k,
                                      LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
+    : pool_size_(pool_size),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      max_resident_frames_(pool_size / 4),
+      memory_budget_(pool_size * BUSTUB_PAGE_SIZE),
+      memory_used_(pool_size * BUSTUB_PAGE_SIZE),
+      serial_(next_pool_serial.fetch_add(1)) {
   // we allocate a consecutive memory space for the buffer pool
   pages_ = new Page[pool_size_];
-  replacer_ = std::make_unique<LRUKReplacer>(pool_size, replacer_k);
+  replacer_ = std::make_unique<LRUKReplacer>(pool_size, replacer_k, LRUK_REPLACER_DIRTY_SKIP);
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
   }
+  // Large pages created before a restart are still read whole
+  for (auto [page_id, size_class] : disk_manager_->ReadSizeClasses()) {
+    page_size_classes_[page_id] = size_class;
+  }
+}
+
+BufferPoolManager::~BufferPoolManager() {
+  StopEvictorThread();
+  if (max_pin_cache_entries_ != 0) {
+    // Nothing will release the pins parked in the pool any more, just forget them
+    std::scoped_lock scoped_lock(live_pools_latch);
+    live_pools.erase(serial_);
+    for (ThreadPinCache *cache : pin_caches) {
+      cache->Remove(serial_);
+    }
+  }
+  delete[] pages_;
 }
 
-BufferPoolManager::~BufferPoolManager() { delete[] pages_; }
+auto BufferPoolManager::GetPinCache() -> ThreadPinCache & {
+  static thread_local LocalPinCache local_pin_cache;
+  return local_pin_cache.cache_;
+}
+
+void BufferPoolManager::EnableThreadPinCache(size_t max_entries) {
+  max_pin_cache_entries_ = std::min(max_entries, ThreadPinCache::MAX_ENTRIES);
+  std::scoped_lock scoped_lock(live_pools_latch);
+  if (max_pin_cache_entries_ != 0) {
+    live_pools[serial_] = this;
+  } else {
+    live_pools.erase(serial_);
+  }
+}
 
-auto BufferPoolManager::NewPage(page_id_t *page_id) -> Page * {
+auto BufferPoolManager::FlushPinCache() -> size_t {
+  size_t released = 0;
+  for (const auto &entry : GetPinCache().Remove(serial_)) {
+    ReleasePins(entry.page_id_, entry.pins_);
+    released += entry.pins_;
+  }
+  return released;
+}
+
+auto BufferPoolManager::TakeParkedPin(page_id_t page_id) -> Page * {
+  Page *page = GetPinCache().Take(serial_, page_id);
+  if (page != nullptr) {
+    page->parked_pins_ -= 1;
+  }
+  return page;
+}
+
+void BufferPoolManager::ReleasePins(page_id_t page_id, uint32_t pins) {
   std::scoped_lock scoped_lock(latch_);
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id == PageTable::NO_FRAME) {
+    return;
+  }
+  Page &page = pages_[frame_id];
+  page.parked_pins_ -= static_cast<int>(pins);
+  page.pin_count_ -= std::min(page.pin_count_.load(), static_cast<int>(pins));
+  if (page.pin_count_ == 0) {
+    replacer_->SetEvictable(frame_id, true);
+  }
+}
+
+void BufferPoolManager::DrainPinCaches(page_id_t page_id) {
+  std::vector<ThreadPinCache::Entry> drained;
+  {
+    std::scoped_lock scoped_lock(live_pools_latch);
+    for (ThreadPinCache *cache : pin_caches) {
+      auto removed = cache->Remove(serial_, page_id);
+      drained.insert(drained.end(), removed.begin(), removed.end());
+    }
+  }
+  for (const auto &entry : drained) {
+    ReleasePins(entry.page_id_, entry.pins_);
+  }
+}
+
+auto BufferPoolManager::NewPage(page_id_t *page_id, tenant_id_t tenant) -> Page * {
+  return CreatePage(page_id, PageSizeClass::Size4K, tenant, true);
+}
+
+auto BufferPoolManager::NewPage(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant) -> Page * {
+  return CreatePage(page_id, size_class, tenant, true);
+}
+
+auto BufferPoolManager::NewPageUninitialized(page_id_t *page_id, tenant_id_t tenant) -> Page * {
+  return CreatePage(page_id, PageSizeClass::Size4K, tenant, false);
+}
+
+auto BufferPoolManager::CreatePage(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant, bool zero)
+    -> Page * {
+  Page *page = NewPageShared(page_id, size_class, tenant, zero);
+  if (page == nullptr && max_pin_cache_entries_ != 0 && FlushPinCache() != 0) {
+    // Our own parked pins may be what holds the frames
+    page = NewPageShared(page_id, size_class, tenant, zero);
+  }
+  CompressEvicted();
+  return page;
+}
+
+auto BufferPoolManager::NewPageShared(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant, bool zero)
+    -> Page * {
+  std::unique_lock lock(latch_);
 
   frame_id_t replace_frame;
-  if (!free_list_.empty()) {
-    replace_frame = free_list_.front();
-    free_list_.pop_front();
-  } else if (!replacer_->Evict(&replace_frame)) {
-    // No evictable frame in both free_list or replacer, just return nullptr
-    return nullptr;
+  bool probation;
+  for (;;) {
+    lsn_t wait_lsn = INVALID_LSN;
+    if (AcquireFrame(INVALID_PAGE_ID, tenant, &replace_frame, &probation, &wait_lsn)) {
+      EvictPage(replace_frame);
+      if (PrepareFrame(replace_frame, size_class, tenant, &wait_lsn)) {
+        break;
+      }
+    }
+    if (wait_lsn == INVALID_LSN) {
+      // No evictable frame in both free_list or replacer, just return nullptr
+      return nullptr;
+    }
+    // The victim can't be written before its log records, wait for them without holding up everyone else
+    lock.unlock();
+    log_manager_->WaitForDurable(wait_lsn);
+    lock.lock();
   }
 
   // Now we get the replace_frame id, get the next available page_id
-  *page_id = AllocatePage();
-  if (pages_[replace_frame].is_dirty_) {
-    // First write out the content, using the not-yet-removed page_id_
-    disk_manager_->WritePage(pages_[replace_frame].page_id_, pages_[replace_frame].data_);
+  *page_id = AllocatePage(PagesInClass(size_class));
+  if (*page_id == INVALID_PAGE_ID) {
+    // No run of consecutive ids for a large page, the frame goes back unused
+    pages_[replace_frame].page_id_ = INVALID_PAGE_ID;
+    pages_[replace_frame].pin_count_ = 0;
+    pages_[replace_frame].is_dirty_ = false;
+    pages_[replace_frame].dirty_ranges_.Clear();
+    free_list_.push_back(replace_frame);
+    return nullptr;
+  }
+  if (SizeClassOf(*page_id) != size_class) {
+    // Recorded before the page can reach the disk. A 4 KiB page only gets here over a stale record of its id.
+    disk_manager_->WriteSizeClass(*page_id, size_class);
+    if (size_class == PageSizeClass::Size4K) {
+      page_size_classes_.erase(*page_id);
+    } else {
+      page_size_classes_[*page_id] = size_class;
+    }
   }
 
-  // Remove the entry from page_table
-  page_table_.erase(pages_[replace_frame].page_id_);
   // 'Pin' the current frame(new page, so to speak)
   replacer_->RecordAccess(replace_frame);
   replacer_->SetEvictable(replace_frame, false);
+  replacer_->SetTenant(replace_frame, tenant);
   // Set metadata
-  pages_[replace_frame].ResetMemory();
+  if (zero && streaming_zero_fill_) {
+    pages_[replace_frame].ResetMemoryStreaming();
+  } else if (zero) {
+    pages_[replace_frame].ResetMemory();
+  }
+  // The page id goes in before the pin, which would let PinLatchFree look at it
+  pages_[replace_frame].page_id_ = *page_id;
   pages_[replace_frame].pin_count_ = 1;
   pages_[replace_frame].is_dirty_ = false;
-  pages_[replace_frame].page_id_ = *page_id;
+  pages_[replace_frame].rec_lsn_ = NextLSN();
+  // Nothing on disk to apply a delta to yet
+  pages_[replace_frame].dirty_ranges_.MarkAll();
 
   // Register the mapping on page_table
-  page_table_[*page_id] = replace_frame;
+  page_table_.Insert(*page_id, replace_frame);
 
   return &pages_[replace_frame];
 }
 
-auto BufferPoolManager::FetchPage(page_id_t page_id, [[maybe_unused]] AccessType access_type) -> Page * {
-  std::scoped_lock scoped_lock(latch_);
+auto BufferPoolManager::FetchPage(page_id_t page_id, [[maybe_unused]] AccessType access_type, tenant_id_t tenant)
+    -> Page * {
+  Page *page = nullptr;
+  if (max_pin_cache_entries_ == 0) {
+    page = FetchPageShared(page_id, tenant);
+    CompressEvicted();
+    return page;
+  }
+  page = TakeParkedPin(page_id);
+  if (page != nullptr) {
+    return page;
+  }
+  page = FetchPageShared(page_id, tenant);
+  if (page == nullptr && FlushPinCache() != 0) {
+    page = FetchPageShared(page_id, tenant);
+  }
+  CompressEvicted();
+  return page;
+}
 
-  frame_id_t replace_frame;
-  if (page_table_.find(page_id) == page_table_.end()) {
-    // No existence in the current page_table
-    if (free_list_.empty()) {
-      // No available page in the current free_list, then try to find it in replacer
-      if (!replacer_->Evict(&replace_frame)) {
-        // Not available for either free_list or replacer, so just quit
-        return nullptr;
-      }
-    } else {
-      // Just grad the frame_id_ from free_list_
-      replace_frame = free_list_.front();
-      free_list_.pop_front();
+auto BufferPoolManager::PinLatchFree(page_id_t page_id, tenant_id_t tenant) -> Page * {
+  if (tenant != DEFAULT_TENANT || admission_sketch_ != nullptr) {
+    return nullptr;
+  }
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id == PageTable::NO_FRAME) {
+    return nullptr;
+  }
+  Page &page = pages_[frame_id];
+  // An unpinned frame may be evicted and reused any time, one that is pinned stays put until it is unpinned
+  int pins = page.pin_count_.load();
+  do {
+    if (pins <= 0) {
+      return nullptr;
     }
-  } else {
-    // The page requested is currently in the buffer pool, then just return it
-    // A new holder of the page
-    pages_[page_table_[page_id]].pin_count_ += 1;
-    replacer_->RecordAccess(page_table_[page_id]);
-    replacer_->SetEvictable(page_table_[page_id], false);
-    return &pages_[page_table_[page_id]];
+  } while (!page.pin_count_.compare_exchange_weak(pins, pins + 1));
+  if (page.page_id_ != page_id) {
+    // The page left the frame after the lookup, and the pin landed on the next page to use it
+    std::scoped_lock scoped_lock(latch_);
+    page.pin_count_ -= 1;
+    if (page.pin_count_ == 0) {
+      replacer_->SetEvictable(frame_id, true);
+    }
+    return nullptr;
   }
+  hit_count_ += 1;
+  latch_free_hits_ += 1;
+  // Already not evictable, the replacer has its own latch for the history
+  replacer_->RecordAccess(frame_id);
+  return &page;
+}
 
-  if (pages_[replace_frame].is_dirty_) {
-    disk_manager_->WritePage(pages_[replace_frame].page_id_, pages_[replace_frame].data_);
+auto BufferPoolManager::FetchPageShared(page_id_t page_id, tenant_id_t tenant) -> Page * {
+  Page *page = PinLatchFree(page_id, tenant);
+  if (page != nullptr) {
+    return page;
+  }
+  std::unique_lock lock(latch_);
+  TenantStats &stats = tenant_stats_[tenant];
+
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id != PageTable::NO_FRAME) {
+    // The page requested is currently in the buffer pool, then just return it
+    return PinHit(frame_id, tenant);
+  }
+  if (admission_sketch_ != nullptr) {
+    admission_sketch_->Increment(page_id);
   }
 
-  page_table_.erase(pages_[replace_frame].page_id_);
-  disk_manager_->ReadPage(page_id, pages_[replace_frame].data_);
+  // No existence in the current page_table
+  miss_count_ += 1;
+  stats.misses_ += 1;
+  frame_id_t replace_frame;
+  bool probation = false;
+  PageSizeClass size_class = SizeClassOf(page_id);
+  for (;;) {
+    lsn_t wait_lsn = INVALID_LSN;
+    if (AcquireFrame(page_id, tenant, &replace_frame, &probation, &wait_lsn)) {
+      EvictPage(replace_frame);
+      if (PrepareFrame(replace_frame, size_class, tenant, &wait_lsn)) {
+        break;
+      }
+    }
+    if (wait_lsn == INVALID_LSN) {
+      // Not available for either free_list or replacer, so just quit
+      return nullptr;
+    }
+    // The victim can't be written before its log records, wait for them without holding up everyone else
+    lock.unlock();
+    log_manager_->WaitForDurable(wait_lsn);
+    lock.lock();
+    // Someone else may have brought the page in meanwhile
+    frame_id = page_table_.Find(page_id);
+    if (frame_id != PageTable::NO_FRAME) {
+      return PinHit(frame_id, tenant);
+    }
+  }
+  if (size_class != PageSizeClass::Size4K) {
+    disk_manager_->ReadPages(page_id, pages_[replace_frame].data_, PagesInClass(size_class));
+  } else if (compressed_cache_ == nullptr || !compressed_cache_->Lookup(page_id, pages_[replace_frame].data_)) {
+    // A page evicted not too long ago may still be in the compressed tier, which saves the disk read
+    disk_manager_->ReadPage(page_id, pages_[replace_frame].data_);
+  }
   // Update metadata for the current page
   pages_[replace_frame].page_id_ = page_id;
   pages_[replace_frame].is_dirty_ = false;
+  pages_[replace_frame].rec_lsn_ = NextLSN();
+  pages_[replace_frame].dirty_ranges_.Clear();
   pages_[replace_frame].pin_count_ = 1;
   // For page_table
-  page_table_[page_id] = replace_frame;
+  page_table_.Insert(page_id, replace_frame);
   // Also 'Pin' the current page in replacer
   replacer_->RecordAccess(replace_frame);
   replacer_->SetEvictable(replace_frame, false);
+  replacer_->SetProbation(replace_frame, probation);
+  replacer_->SetTenant(replace_frame, tenant);
   return &pages_[replace_frame];
 }
 
+void BufferPoolManager::CompressEvicted() {
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->CompressDeferred();
+  }
+}
+
+auto BufferPoolManager::PinHit(frame_id_t frame_id, tenant_id_t tenant) -> Page * {
+  hit_count_ += 1;
+  tenant_stats_[tenant].hits_ += 1;
+  // A new holder of the page
+  pages_[frame_id].pin_count_ += 1;
+  if (pages_[frame_id].is_resident_) {
+    // Resident pages can never be evicted, so there is nothing to tell the replacer
+    return &pages_[frame_id];
+  }
+  replacer_->RecordAccess(frame_id);
+  replacer_->SetEvictable(frame_id, false);
+  if (admission_sketch_ != nullptr) {
+    admission_sketch_->Increment(pages_[frame_id].page_id_);
+    // A second access earns a page in the probation window its admission
+    replacer_->SetProbation(frame_id, false);
+  }
+  return &pages_[frame_id];
+}
+
 auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty, [[maybe_unused]] AccessType access_type) -> bool {
+  DirtyRangeSet modified;
+  if (is_dirty) {
+    modified.MarkAll();
+  }
+  return UnpinPage(page_id, modified);
+}
+
+auto BufferPoolManager::UnpinPage(page_id_t page_id, const DirtyRangeSet &modified) -> bool {
+  if (max_pin_cache_entries_ == 0) {
+    return UnpinPageShared(page_id, modified, nullptr);
+  }
+  // Report the modification right away so that flushes and checkpoints see it, only the pin is parked. Checking
+  // the pin under the latch keeps an unpin of a page we don't hold from parking a pin nobody has.
+  Page *page;
+  if (!UnpinPageShared(page_id, modified, &page)) {
+    return false;
+  }
+  ThreadPinCache::Entry evicted;
+  if (GetPinCache().Park(serial_, page_id, page, max_pin_cache_entries_, &evicted)) {
+    if (evicted.pool_ == serial_) {
+      ReleasePins(evicted.page_id_, evicted.pins_);
+    } else {
+      std::scoped_lock scoped_lock(live_pools_latch);
+      auto it = live_pools.find(evicted.pool_);
+      if (it != live_pools.end()) {
+        it->second->ReleasePins(evicted.page_id_, evicted.pins_);
+      }
+    }
+  }
+  return true;
+}
+
+auto BufferPoolManager::UnpinPageShared(page_id_t page_id, const DirtyRangeSet &modified, Page **parked) -> bool {
   std::scoped_lock scoped_lock(latch_);
-  if (page_table_.find(page_id) == page_table_.end()) {
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id == PageTable::NO_FRAME) {
     return false;
   }
-  if (pages_[page_table_[page_id]].pin_count_ <= 0) {
+  // Parked pins belong to the pin caches, not to whoever is unpinning
+  if (pages_[frame_id].pin_count_ - pages_[frame_id].parked_pins_ <= 0) {
     return false;
   }
 
-  if (is_dirty) {
-    pages_[page_table_[page_id]].is_dirty_ = true;
+  if (!modified.IsEmpty()) {
+    pages_[frame_id].is_dirty_ = true;
+    pages_[frame_id].dirty_ranges_.Merge(modified);
+    pages_[frame_id].dirty_version_ += 1;
+    // Let the replacer know this frame now costs a write to evict
+    replacer_->SetDirty(frame_id, true);
     // Otherwise, DO NOT change anything
   }
+  if (parked != nullptr) {
+    pages_[frame_id].parked_pins_ += 1;
+    *parked = &pages_[frame_id];
+    return true;
+  }
   // Update metadata about the current page
-  pages_[page_table_[page_id]].pin_count_ -= 1;
+  pages_[frame_id].pin_count_ -= 1;
   // If the pin_count_ is 0, set the status to evictable
-  if (pages_[page_table_[page_id]].pin_count_ == 0) {
-    replacer_->SetEvictable(page_table_[page_id], true);
+  if (pages_[frame_id].pin_count_ == 0) {
+    replacer_->SetEvictable(frame_id, true);
   }
   return true;
 }
 
 auto BufferPoolManager::FlushPage(page_id_t page_id) -> bool {
-  std::scoped_lock scoped_lock(latch_);
   if (page_id == INVALID_PAGE_ID) {
     return false;
   }
-  if (page_table_.find(page_id) == page_table_.end()) {
-    return false;
+  std::unique_lock lock(latch_);
+  frame_id_t frame_id;
+  for (;;) {
+    frame_id = page_table_.Find(page_id);
+    if (frame_id == PageTable::NO_FRAME) {
+      return false;
+    }
+    lsn_t page_lsn = pages_[frame_id].GetLSN();
+    if (log_manager_ == nullptr || log_manager_->IsDurable(page_lsn)) {
+      break;
+    }
+    // WAL: wait for the log before taking the page out, without holding up everyone else meanwhile
+    lock.unlock();
+    log_manager_->WaitForDurable(page_lsn);
+    lock.lock();
   }
 
-  disk_manager_->WritePage(page_id, pages_[page_table_[page_id]].data_);
-  pages_[page_table_[page_id]].is_dirty_ = false;
+  // Taken before the write, so that a change logged while it runs is not taken as written
+  lsn_t clean_lsn = NextLSN();
+  WritePageToDisk(&pages_[frame_id]);
+  MarkClean(&pages_[frame_id], clean_lsn);
 
   return true;
 }
 
 void BufferPoolManager::FlushAllPages() {
-  std::scoped_lock scoped_lock(latch_);
-  for (size_t i = 0; i < pool_size_; ++i) {
-    FlushPage(static_cast<page_id_t>(i));
+  if (max_pin_cache_entries_ != 0) {
+    // Leave every page evictable once it is clean
+    DrainPinCaches();
   }
+  WriteBackPages(SnapshotDirtyPages());
+  disk_manager_->Sync();
 }
 
-auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool {
-  std::scoped_lock scoped_lock(latch_);
+auto BufferPoolManager::Checkpoint() -> lsn_t {
+  WriteBackPages(SnapshotDirtyPages());
+
+  // Everything older than the oldest change still in memory has been written by now, by us or by an eviction
+  lsn_t min_recovery_lsn;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    min_recovery_lsn = NextLSN();
+    for (size_t i = 0; i < pool_size_; ++i) {
+      if (pages_[i].page_id_ != INVALID_PAGE_ID && pages_[i].is_dirty_) {
+        min_recovery_lsn = std::min(min_recovery_lsn, pages_[i].rec_lsn_);
+      }
+    }
+  }
+  // The checkpoint record must not become durable before the pages it vouches for. Syncing only after taking the
+  // LSN covers the pages evicted while we wrote, which are no longer in the pool to hold it back.
+  disk_manager_->Sync();
+  if (log_manager_ != nullptr) {
+    CheckpointRecord record;
+    record.min_recovery_lsn_ = min_recovery_lsn;
+    log_manager_->WaitForDurable(
+        log_manager_->AppendLogRecord(reinterpret_cast<const char *>(&record), sizeof(record)));
+  }
+  return min_recovery_lsn;
+}
 
+auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool {
   if (page_id == INVALID_PAGE_ID) {
     return true;
   }
-  if (page_table_.find(page_id) == page_table_.end()) {
+  if (max_pin_cache_entries_ != 0) {
+    // Before the check below, which would fail on a parked pin. INVALID_PAGE_ID would drain every page.
+    DrainPinCaches(page_id);
+  }
+  std::scoped_lock scoped_lock(latch_);
+
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->Erase(page_id);
+  }
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id == PageTable::NO_FRAME) {
+    DeallocatePage(page_id);
     return true;
   }
-  if (pages_[page_table_[page_id]].pin_count_ > 0) {
+  if (pages_[frame_id].pin_count_ > 0) {
     // 'Pinned' page can't be deleted
     return false;
   }
+  if (pages_[frame_id].swip_parent_ != nullptr && !UnswizzleParentSwip(&pages_[frame_id])) {
+    // Reachable through a swizzled swip in a latched parent, just like a pinned page
+    return false;
+  }
+  UnswizzleAll(&pages_[frame_id]);
   // Then remove the relevant frame from replacer
-  replacer_->Remove(page_table_[page_id]);
+  replacer_->Remove(frame_id);
   // Add back to the free_list_
-  free_list_.emplace_back(page_table_[page_id]);
-  // Reset the relevant metadata of the deleted page
-  pages_[page_table_[page_id]].ResetMemory();
-  pages_[page_table_[page_id]].pin_count_ = 0;
-  pages_[page_table_[page_id]].page_id_ = INVALID_PAGE_ID;
-  pages_[page_table_[page_id]].is_dirty_ = false;
+  free_list_.emplace_back(frame_id);
+  // Reset the relevant metadata of the deleted page, the data is zeroed if and when NewPage reuses the frame
+  pages_[frame_id].pin_count_ = 0;
+  pages_[frame_id].page_id_ = INVALID_PAGE_ID;
+  pages_[frame_id].is_dirty_ = false;
+  pages_[frame_id].dirty_ranges_.Clear();
   // Update page_table
-  page_table_.erase(page_id);
-  // Imitate freeing the page on the disk
+  page_table_.Erase(page_id);
+  // Release its space on disk
   DeallocatePage(page_id);
   return true;
 }
 
-auto BufferPoolManager::AllocatePage() -> page_id_t { return next_page_id_++; }
+auto BufferPoolManager::AllocatePage(size_t num_pages) -> page_id_t {
+  page_id_t page_id;
+  if (!disk_manager_->AllocatePages(num_pages, &page_id)) {
+    return INVALID_PAGE_ID;
+  }
+  if (page_id == INVALID_PAGE_ID) {
+    return next_page_id_.fetch_add(static_cast<page_id_t>(num_pages));
+  }
+  return page_id;
+}
+
+void BufferPoolManager::DeallocatePage(page_id_t page_id) {
+  auto it = page_size_classes_.find(page_id);
+  if (it == page_size_classes_.end()) {
+    disk_manager_->DeallocatePage(page_id);
+    return;
+  }
+  // Forget the size class first, its ids may be handed out again right after
+  disk_manager_->WriteSizeClass(page_id, PageSizeClass::Size4K);
+  for (size_t i = 0; i < PagesInClass(it->second); ++i) {
+    disk_manager_->DeallocatePage(page_id + static_cast<page_id_t>(i));
+  }
+  page_size_classes_.erase(it);
+}
+
+void BufferPoolManager::EvictPage(frame_id_t frame_id) {
+  Page &page = pages_[frame_id];
+  if (page.page_id_ == INVALID_PAGE_ID) {
+    // Came from the free list
+    return;
+  }
+  // Nobody holds the page any more, so its swips can go back to page ids in place
+  UnswizzleAll(&page);
+  if (page.is_dirty_) {
+    // First write out the content, using the not-yet-removed page_id_
+    WritePageToDisk(&page);
+  }
+  if (compressed_cache_ != nullptr && page.size_class_ == PageSizeClass::Size4K) {
+    // Only a copy under the latch, the compression is left to CompressEvicted
+    compressed_cache_->InsertDeferred(page.page_id_, page.data_);
+  }
+  // Remove the entry from page_table
+  page_table_.Erase(page.page_id_);
+}
+
+auto BufferPoolManager::SnapshotDirtyPages() -> std::vector<std::pair<page_id_t, lsn_t>> {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  std::scoped_lock scoped_lock(latch_);
+  // Walk the frames rather than page ids, the pages in the pool can have any id
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].page_id_ != INVALID_PAGE_ID && pages_[i].is_dirty_) {
+      dirty_pages.emplace_back(pages_[i].page_id_, pages_[i].rec_lsn_);
+    }
+  }
+  return dirty_pages;
+}
 
-auto BufferPoolManager::FetchPageBasic(page_id_t page_id) -> BasicPageGuard { return {this, FetchPage(page_id)}; }
+void BufferPoolManager::WriteBackPages(std::vector<std::pair<page_id_t, lsn_t>> dirty_pages) {
+  // Page-id order keeps the writes as sequential as the file layout allows
+  std::sort(dirty_pages.begin(), dirty_pages.end());
 
-auto BufferPoolManager::FetchPageRead(page_id_t page_id) -> ReadPageGuard {
+  // Give each I/O thread a contiguous page-id range so that every stream stays sequential
+  size_t num_threads = std::max<size_t>(1, std::min(flush_threads_, dirty_pages.size()));
+  size_t chunk = (dirty_pages.size() + num_threads - 1) / std::max<size_t>(1, num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; ++t) {
+    size_t begin = std::min(t * chunk, dirty_pages.size());
+    size_t end = std::min(begin + chunk, dirty_pages.size());
+    threads.emplace_back([&, begin, end] { WriteBackRange(dirty_pages.data() + begin, dirty_pages.data() + end); });
+  }
+  // The caller takes the first range itself
+  WriteBackRange(dirty_pages.data(), dirty_pages.data() + std::min(chunk, dirty_pages.size()));
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void BufferPoolManager::WriteBackRange(const std::pair<page_id_t, lsn_t> *begin,
+                                       const std::pair<page_id_t, lsn_t> *end) {
+  size_t buffer_size = BUSTUB_PAGE_SIZE;
+  auto buffer = std::make_unique<char[]>(buffer_size);
+  std::vector<std::pair<page_id_t, lsn_t>> busy;
+  for (auto it = begin; it != end; ++it) {
+    if (!WriteBackPage(it->first, it->second, &buffer, &buffer_size)) {
+      busy.push_back(*it);
+    }
+  }
+  // The latch may be held by our own caller, so a busy page is only given a few more chances
+  for (int retry = 0; retry < WRITE_BACK_RETRIES && !busy.empty(); ++retry) {
+    std::this_thread::yield();
+    auto still_busy = busy.begin();
+    for (auto &[page_id, rec_lsn] : busy) {
+      if (!WriteBackPage(page_id, rec_lsn, &buffer, &buffer_size)) {
+        *still_busy++ = {page_id, rec_lsn};
+      }
+    }
+    busy.erase(still_busy, busy.end());
+  }
+}
+
+auto BufferPoolManager::WriteBackPage(page_id_t page_id, lsn_t rec_lsn, std::unique_ptr<char[]> *buffer,
+                                      size_t *buffer_size) -> bool {
+  Page *page;
+  uint64_t dirty_version;
+  DirtyRangeSet dirty_ranges;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    frame_id_t frame_id = page_table_.Find(page_id);
+    // Evicted, flushed or flushed and dirtied again since the snapshot: its old changes are on disk already
+    if (frame_id == PageTable::NO_FRAME || !pages_[frame_id].is_dirty_ || pages_[frame_id].rec_lsn_ != rec_lsn) {
+      return true;
+    }
+    page = &pages_[frame_id];
+    // Pin it so that it stays in its frame while we write it without the latch
+    page->pin_count_ += 1;
+    replacer_->SetEvictable(frame_id, false);
+    dirty_version = page->dirty_version_;
+    // Only changes reported through an unpin are in the ranges, and MarkClean below is skipped if one came in
+    dirty_ranges = page->dirty_ranges_;
+  }
+
+  // Copy under the page latch to get a consistent image, then write the copy. Waiting for the latch could
+  // deadlock with a caller that holds it, or with a writer queued behind a reader that does.
+  bool latched = page->rwlatch_.TryRLock();
+  lsn_t clean_lsn = INVALID_LSN;
+  if (latched) {
+    if (page->GetSize() > *buffer_size) {
+      *buffer_size = page->GetSize();
+      *buffer = std::make_unique<char[]>(*buffer_size);
+    }
+    memcpy(buffer->get(), page->GetData(), page->GetSize());
+    lsn_t page_lsn = page->GetLSN();
+    // Writers log under the write latch, so anything logged from here on is missing from the copy
+    clean_lsn = NextLSN();
+    if (max_swizzled_ != 0) {
+      // Swips are only unswizzled under the page's write latch or once it is unpinned, so the pointers in the
+      // copy are still valid while we hold the read latch
+      std::scoped_lock scoped_lock(latch_);
+      UnswizzleImage(page, buffer->get());
+    }
+    page->rwlatch_.RUnlock();
+    if (log_manager_ != nullptr) {
+      log_manager_->WaitForDurable(page_lsn);
+    }
+    WriteImage(page_id, page->size_class_, buffer->get(), dirty_ranges);
+  }
+
+  std::scoped_lock scoped_lock(latch_);
+  if (latched && page->dirty_version_ == dirty_version) {
+    // Nobody reported a change since we took the copy, and a change not reported yet is past clean_lsn
+    MarkClean(page, clean_lsn);
+  }
+  page->pin_count_ -= 1;
+  if (page->pin_count_ == 0) {
+    replacer_->SetEvictable(static_cast<frame_id_t>(page - pages_), true);
+  }
+  return latched;
+}
+
+void BufferPoolManager::UnswizzleImage(Page *page, char *image) {
+  for (uint32_t offset : page->swizzled_swips_) {
+    uint64_t value;
+    memcpy(&value, image + offset, sizeof(value));
+    if (Swip::IsSwizzled(value)) {
+      value = Swip::Encode(Swip::PageOf(value)->page_id_);
+      memcpy(image + offset, &value, sizeof(value));
+    }
+  }
+}
+
+void BufferPoolManager::UnswizzleAll(Page *page) {
+  for (uint32_t offset : page->swizzled_swips_) {
+    auto *swip = reinterpret_cast<Swip *>(page->data_ + offset);
+    Page *target = Swip::PageOf(swip->value_.load(std::memory_order_relaxed));
+    swip->value_.store(Swip::Encode(target->page_id_), std::memory_order_relaxed);
+    target->swip_parent_ = nullptr;
+    num_swizzled_ -= 1;
+  }
+  page->swizzled_swips_.clear();
+}
+
+auto BufferPoolManager::UnswizzleParentSwip(Page *page) -> bool {
+  Page *parent = page->swip_parent_;
+  // Whoever holds the parent latched may be following the swip right now
+  if (!parent->rwlatch_.TryWLock()) {
+    return false;
+  }
+  DetachSwip(page);
+  parent->rwlatch_.WUnlock();
+  return true;
+}
+
+void BufferPoolManager::DetachSwip(Page *page) {
+  Page *parent = page->swip_parent_;
+  auto *swip = reinterpret_cast<Swip *>(parent->data_ + page->swip_offset_);
+  swip->value_.store(Swip::Encode(page->page_id_), std::memory_order_release);
+  auto &swips = parent->swizzled_swips_;
+  swips.erase(std::find(swips.begin(), swips.end(), page->swip_offset_));
+  page->swip_parent_ = nullptr;
+  num_swizzled_ -= 1;
+}
+
+void BufferPoolManager::MarkClean(Page *page, lsn_t rec_lsn) {
+  page->is_dirty_ = false;
+  page->dirty_ranges_.Clear();
+  page->rec_lsn_ = rec_lsn;
+  replacer_->SetDirty(static_cast<frame_id_t>(page - pages_), false);
+}
+
+void BufferPoolManager::WritePageToDisk(Page *page) {
+  if (log_manager_ != nullptr) {
+    // WAL: the log records describing the changes must reach the disk before the changes themselves. Callers
+    // wait for the log before taking the latch, so this only blocks if the page was logged again since.
+    log_manager_->WaitForDurable(page->GetLSN());
+  }
+  if (page->swizzled_swips_.empty()) {
+    WriteImage(page->page_id_, page->size_class_, page->data_, page->dirty_ranges_);
+    return;
+  }
+  // The frame pointers mean nothing on disk
+  auto image = std::make_unique<char[]>(page->GetSize());
+  memcpy(image.get(), page->data_, page->GetSize());
+  UnswizzleImage(page, image.get());
+  WriteImage(page->page_id_, page->size_class_, image.get(), page->dirty_ranges_);
+}
+
+void BufferPoolManager::WriteImage(page_id_t page_id, PageSizeClass size_class, const char *data,
+                                   const DirtyRangeSet &dirty_ranges) {
+  if (size_class != PageSizeClass::Size4K) {
+    // Dirty ranges only cover the first block, a large page is always written whole
+    disk_manager_->WritePages(page_id, data, PagesInClass(size_class));
+  } else if (dirty_ranges.IsAll() || dirty_ranges.IsEmpty()) {
+    // FlushPage writes clean pages too, in full
+    disk_manager_->WritePage(page_id, data);
+  } else {
+    // SetLSN writes the header without going through a guard, and redo relies on the page LSN being on disk
+    // along with the change it covers
+    DirtyRangeSet ranges = dirty_ranges;
+    ranges.Add(Page::OFFSET_CHECKSUM, Page::OFFSET_LSN + sizeof(lsn_t));
+    disk_manager_->WritePageDelta(page_id, data, ranges);
+  }
+}
+
+auto BufferPoolManager::AcquireFrame(page_id_t candidate, tenant_id_t tenant, frame_id_t *frame_id, bool *probation,
+                                     lsn_t *wait_lsn) -> bool {
+  *probation = false;
+  if (!free_list_.empty() && replacer_->CanGrow(tenant)) {
+    // Just grab the frame from free_list_
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    if (free_list_.size() < free_reserve_) {
+      evictor_cv_.notify_one();
+    }
+    return true;
+  }
+
+  frame_id_t victim;
+  if (admission_sketch_ != nullptr && candidate != INVALID_PAGE_ID && replacer_->PeekVictim(&victim, tenant) &&
+      !replacer_->IsProbation(victim) &&
+      admission_sketch_->Estimate(candidate) <= admission_sketch_->Estimate(pages_[victim].page_id_)) {
+    // The candidate is colder than the victim, so it is not worth the victim's frame. Until the window is full
+    // it grows by taking ordinary victims, afterwards it recycles its own frames.
+    if (replacer_->ProbationSize() < admission_window_) {
+      *probation = true;
+      admission_rejections_ += 1;
+    } else if (EvictVictim(tenant, true, frame_id, wait_lsn)) {
+      *probation = true;
+      admission_rejections_ += 1;
+      return true;
+    } else if (*wait_lsn != INVALID_LSN) {
+      return false;
+    }
+    // If no frame of a full window can be recycled, the candidate is admitted rather than growing the window
+  }
+  return EvictVictim(tenant, false, frame_id, wait_lsn);
+}
+
+auto BufferPoolManager::EvictVictim(tenant_id_t tenant, bool probation_only, frame_id_t *frame_id, lsn_t *wait_lsn)
+    -> bool {
+  if (log_manager_ == nullptr && max_swizzled_ == 0) {
+    return probation_only ? replacer_->EvictProbation(frame_id, tenant) : replacer_->Evict(frame_id, tenant);
+  }
+  // Every frame skipped below gets a fresh access, so after pool_size_ rounds we would be going in circles
+  for (size_t attempt = 0; attempt < pool_size_; ++attempt) {
+    frame_id_t victim;
+    if (!replacer_->PeekVictim(&victim, tenant, probation_only)) {
+      return false;
+    }
+    Page &page = pages_[victim];
+    if (log_manager_ != nullptr && page.is_dirty_ && !log_manager_->IsDurable(page.GetLSN())) {
+      *wait_lsn = page.GetLSN();
+      return false;
+    }
+    if (page.swip_parent_ != nullptr && !UnswizzleParentSwip(&page)) {
+      // The parent is latched, so the swip may be in use: give the page a second chance
+      replacer_->RecordAccess(victim);
+      continue;
+    }
+    // Nothing changed in the replacer since the peek, so the eviction below picks the same frame
+    return probation_only ? replacer_->EvictProbation(frame_id, tenant) : replacer_->Evict(frame_id, tenant);
+  }
+  return false;
+}
+
+auto BufferPoolManager::PrepareFrame(frame_id_t frame_id, PageSizeClass size_class, tenant_id_t tenant,
+                                     lsn_t *wait_lsn) -> bool {
+  Page &page = pages_[frame_id];
+  if (page.data_ != nullptr && page.size_class_ == size_class) {
+    return true;
+  }
+  // Trading buffers with a free frame is just a pointer swap
+  for (frame_id_t free_frame : free_list_) {
+    Page &other = pages_[free_frame];
+    if (other.data_ != nullptr && other.size_class_ == size_class) {
+      std::swap(page.data_, other.data_);
+      std::swap(page.size_class_, other.size_class_);
+      return true;
+    }
+  }
+
+  size_t needed = BUSTUB_PAGE_SIZE * PagesInClass(size_class);
+  memory_used_ -= page.MemorySize();
+  page.ReleaseMemory();
+  page.page_id_ = INVALID_PAGE_ID;
+  while (memory_used_ + needed > memory_budget_) {
+    if (needed > memory_budget_ || !ReleaseFrameMemory(tenant, wait_lsn)) {
+      free_list_.emplace_back(frame_id);
+      return false;
+    }
+  }
+  page.AllocateMemory(size_class);
+  memory_used_ += needed;
+  return true;
+}
+
+auto BufferPoolManager::ReleaseFrameMemory(tenant_id_t tenant, lsn_t *wait_lsn) -> bool {
+  for (frame_id_t free_frame : free_list_) {
+    Page &page = pages_[free_frame];
+    if (page.data_ != nullptr) {
+      memory_used_ -= page.MemorySize();
+      page.ReleaseMemory();
+      return true;
+    }
+  }
+  frame_id_t victim;
+  if (!EvictVictim(tenant, false, &victim, wait_lsn)) {
+    return false;
+  }
+  Page &page = pages_[victim];
+  EvictPage(victim);
+  page.page_id_ = INVALID_PAGE_ID;
+  page.pin_count_ = 0;
+  page.is_dirty_ = false;
+  page.dirty_ranges_.Clear();
+  memory_used_ -= page.MemorySize();
+  page.ReleaseMemory();
+  free_list_.emplace_back(victim);
+  return true;
+}
+
+void BufferPoolManager::RunEvictorThread(size_t free_reserve) {
+  std::scoped_lock scoped_lock(latch_);
+  if (evictor_thread_ != nullptr) {
+    return;
+  }
+  free_reserve_ = std::min(free_reserve, pool_size_);
+  stop_evictor_ = false;
+  evictor_thread_ = std::make_unique<std::thread>([this] { EvictorThreadLoop(); });
+}
+
+void BufferPoolManager::StopEvictorThread() {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    if (evictor_thread_ == nullptr) {
+      return;
+    }
+    stop_evictor_ = true;
+    free_reserve_ = 0;
+  }
+  evictor_cv_.notify_one();
+  evictor_thread_->join();
+  evictor_thread_.reset();
+}
+
+void BufferPoolManager::EvictorThreadLoop() {
+  std::unique_lock lock(latch_);
+  while (!stop_evictor_) {
+    evictor_cv_.wait(lock, [this] { return stop_evictor_ || free_list_.size() < free_reserve_; });
+    if (!stop_evictor_ && RefillFreeList(&lock) == 0) {
+      // Everything is pinned or being written, don't spin on it
+      evictor_cv_.wait_for(lock, EVICTOR_BACKOFF, [this] { return stop_evictor_; });
+    }
+  }
+}
+
+auto BufferPoolManager::RefillFreeList(std::unique_lock<ProfiledMutex<LockSite::BufferPool>> *lock) -> size_t {
+  size_t freed = 0;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  std::vector<frame_id_t> dirty_frames;
+  // Only peek, so that dirty victims and those we can't take keep their history, tenant and probation state
+  size_t wanted = free_reserve_ - std::min(free_reserve_, free_list_.size());
+  for (frame_id_t frame_id : replacer_->PeekVictims(wanted, NO_TENANT)) {
+    Page &page = pages_[frame_id];
+    if (page.is_dirty_) {
+      // Clean it in place, pinned so that nobody else evicts it until it is written back
+      page.pin_count_ += 1;
+      replacer_->SetEvictable(frame_id, false);
+      dirty_pages.emplace_back(page.page_id_, page.rec_lsn_);
+      dirty_frames.push_back(frame_id);
+      continue;
+    }
+    if (page.swip_parent_ != nullptr && !UnswizzleParentSwip(&page)) {
+      // The parent is latched, leave the page where it is
+      continue;
+    }
+    // The frame really leaves the replacer now
+    replacer_->Remove(frame_id);
+    EvictPage(frame_id);
+    page.page_id_ = INVALID_PAGE_ID;
+    page.pin_count_ = 0;
+    free_list_.push_back(frame_id);
+    freed += 1;
+  }
+  background_evictions_ += freed;
+  if (dirty_frames.empty() && (freed == 0 || compressed_cache_ == nullptr)) {
+    return freed;
+  }
+
+  lock->unlock();
+  CompressEvicted();
+  WriteBackPages(std::move(dirty_pages));
+  lock->lock();
+  for (frame_id_t dirty_frame : dirty_frames) {
+    // Now clean with its rank untouched, the replacer picks it again next round unless it was used meanwhile
+    pages_[dirty_frame].pin_count_ -= 1;
+    if (pages_[dirty_frame].pin_count_ == 0) {
+      replacer_->SetEvictable(dirty_frame, true);
+    }
+  }
+  return freed + dirty_frames.size();
+}
+
+auto BufferPoolManager::GetTenantStats(tenant_id_t tenant) -> TenantStats {
+  std::scoped_lock scoped_lock(latch_);
+  TenantStats stats;
+  auto it = tenant_stats_.find(tenant);
+  if (it != tenant_stats_.end()) {
+    stats = it->second;
+  }
+  if (tenant == DEFAULT_TENANT) {
+    stats.hits_ += latch_free_hits_;
+  }
+  stats.frames_ = replacer_->GetTenantFrames(tenant);
+  return stats;
+}
+
+auto BufferPoolManager::MakeResident(page_id_t page_id) -> Page * {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    frame_id_t frame_id = page_table_.Find(page_id);
+    if (frame_id != PageTable::NO_FRAME && pages_[frame_id].is_resident_) {
+      return &pages_[frame_id];
+    }
+    if (resident_frames_ >= max_resident_frames_) {
+      return nullptr;
+    }
+  }
+
+  // The pin taken by FetchPage is kept for as long as the page stays resident
   Page *page = FetchPage(page_id);
+  if (page == nullptr) {
+    return nullptr;
+  }
+
+  std::scoped_lock scoped_lock(latch_);
+  if (page->is_resident_ || resident_frames_ >= max_resident_frames_) {
+    // Lost a race against another MakeResident
+    page->pin_count_ -= 1;
+    if (page->pin_count_ == 0) {
+      replacer_->SetEvictable(page_table_.Find(page_id), true);
+    }
+    return page->is_resident_ ? page : nullptr;
+  }
+  page->is_resident_ = true;
+  resident_frames_ += 1;
+  replacer_->SetProbation(page_table_.Find(page_id), false);
+  return page;
+}
+
+auto BufferPoolManager::ReleaseResident(page_id_t page_id) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  frame_id_t frame_id = page_table_.Find(page_id);
+  if (frame_id == PageTable::NO_FRAME || !pages_[frame_id].is_resident_) {
+    return false;
+  }
+  Page &page = pages_[frame_id];
+  page.is_resident_ = false;
+  resident_frames_ -= 1;
+  // Drop the resident pin, the frame competes for replacement again from now on
+  page.pin_count_ -= 1;
+  replacer_->RecordAccess(frame_id);
+  if (page.pin_count_ == 0) {
+    replacer_->SetEvictable(frame_id, true);
+  }
+  return true;
+}
+
+void BufferPoolManager::EnableCompressedCache(size_t budget_bytes) {
+  std::scoped_lock scoped_lock(latch_);
+  compressed_cache_ = std::make_unique<CompressedPageCache>(budget_bytes);
+}
+
+void BufferPoolManager::EnableHashedPageTable() {
+  std::scoped_lock scoped_lock(latch_);
+  page_table_.EnableHashing(pool_size_);
+}
+
+void BufferPoolManager::EnableAdmissionFilter(size_t window_size) {
+  std::scoped_lock scoped_lock(latch_);
+  admission_sketch_ = std::make_unique<CountMinSketch>(pool_size_);
+  admission_window_ = std::max<size_t>(window_size, 1);
+}
+
+auto BufferPoolManager::FetchPageBasic(page_id_t page_id, tenant_id_t tenant) -> BasicPageGuard {
+  return {this, FetchPage(page_id, AccessType::Unknown, tenant)};
+}
+
+auto BufferPoolManager::FetchPageRead(page_id_t page_id, tenant_id_t tenant) -> ReadPageGuard {
+  Page *page = FetchPage(page_id, AccessType::Unknown, tenant);
   if (page == nullptr) {
     return {this, nullptr};
   }
@@ -182,8 +1081,134 @@ auto BufferPoolManager::FetchPageRead(page_id_t page_id) -> ReadPageGuard {
   return {this, page};
 }
 
-auto BufferPoolManager::FetchPageWrite(page_id_t page_id) -> WritePageGuard {
-  Page *page = FetchPage(page_id);
+auto BufferPoolManager::FetchPageWrite(page_id_t page_id, tenant_id_t tenant) -> WritePageGuard {
+  Page *page = FetchPage(page_id, AccessType::Unknown, tenant);
+  if (page == nullptr) {
+    return {this, nullptr};
+  }
+  page->WLatch();
+  return {this, page};
+}
+
+auto BufferPoolManager::FetchPagesWrite(const std::vector<page_id_t> &page_ids, tenant_id_t tenant)
+    -> MultiPageGuard {
+  MultiPageGuard multi_guard;
+  // The canonical latch order: ascending page id, each page once
+  std::vector<page_id_t> sorted_ids(page_ids);
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+
+  // Pin every page first, latching only once all of them are in the pool, so no latch is held while waiting on I/O
+  std::vector<Page *> pages(sorted_ids.size(), nullptr);
+  if (max_pin_cache_entries_ != 0) {
+    for (size_t i = 0; i < sorted_ids.size(); ++i) {
+      pages[i] = TakeParkedPin(sorted_ids[i]);
+    }
+  }
+  std::vector<size_t> misses;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    for (size_t i = 0; i < sorted_ids.size(); ++i) {
+      if (pages[i] != nullptr) {
+        continue;
+      }
+      frame_id_t frame_id = page_table_.Find(sorted_ids[i]);
+      if (frame_id == PageTable::NO_FRAME) {
+        misses.push_back(i);
+        continue;
+      }
+      pages[i] = PinHit(frame_id, tenant);
+    }
+  }
+  for (size_t i : misses) {
+    pages[i] = FetchPage(sorted_ids[i], AccessType::Unknown, tenant);
+    if (pages[i] == nullptr) {
+      // All or nothing
+      for (size_t j = 0; j < sorted_ids.size(); ++j) {
+        if (pages[j] != nullptr) {
+          UnpinPage(sorted_ids[j], false);
+        }
+      }
+      return multi_guard;
+    }
+  }
+
+  multi_guard.guards_.reserve(sorted_ids.size());
+  for (Page *page : pages) {
+    page->WLatch();
+    multi_guard.guards_.emplace_back(this, page);
+  }
+  multi_guard.positions_.reserve(page_ids.size());
+  for (page_id_t page_id : page_ids) {
+    multi_guard.positions_.push_back(std::lower_bound(sorted_ids.begin(), sorted_ids.end(), page_id) -
+                                     sorted_ids.begin());
+  }
+  multi_guard.page_ids_ = std::move(sorted_ids);
+  return multi_guard;
+}
+
+auto BufferPoolManager::FetchPageSwip(page_id_t parent_id, Swip *swip) -> Page * {
+  uint64_t value = swip->value_.load(std::memory_order_acquire);
+  if (Swip::IsSwizzled(value)) {
+    // Straight to the frame: the page can't be evicted before the swip is unswizzled, which takes the parent's
+    // write latch
+    Page *page = Swip::PageOf(value);
+    auto frame_id = static_cast<frame_id_t>(page - pages_);
+    std::scoped_lock scoped_lock(latch_);
+    hit_count_ += 1;
+    tenant_stats_[DEFAULT_TENANT].hits_ += 1;
+    page->pin_count_ += 1;
+    if (!page->is_resident_) {
+      replacer_->RecordAccess(frame_id);
+      replacer_->SetEvictable(frame_id, false);
+      if (admission_sketch_ != nullptr) {
+        admission_sketch_->Increment(page->page_id_);
+        replacer_->SetProbation(frame_id, false);
+      }
+    }
+    return page;
+  }
+
+  Page *page = FetchPage(Swip::PageIdOf(value));
+  if (page == nullptr || max_swizzled_ == 0) {
+    return page;
+  }
+  std::scoped_lock scoped_lock(latch_);
+  frame_id_t parent_frame = page_table_.Find(parent_id);
+  if (parent_frame == PageTable::NO_FRAME || num_swizzled_ >= max_swizzled_) {
+    return page;
+  }
+  Page *parent = &pages_[parent_frame];
+  auto offset = reinterpret_cast<char *>(swip) - parent->data_;
+  if (parent == page || offset < 0 || offset > static_cast<std::ptrdiff_t>(parent->GetSize() - sizeof(Swip)) ||
+      offset % alignof(Swip) != 0) {
+    // A page can't refer to itself, and a swip outside the parent can't be tracked
+    return page;
+  }
+  if (swip->value_.load(std::memory_order_relaxed) != value || page->swip_parent_ != nullptr) {
+    // Another reader swizzled it first, or another swip already points at the frame
+    return page;
+  }
+  // No pin: the back reference lets the eviction of the page unswizzle the swip
+  swip->value_.store(Swip::Encode(page), std::memory_order_release);
+  parent->swizzled_swips_.push_back(static_cast<uint32_t>(offset));
+  page->swip_parent_ = parent;
+  page->swip_offset_ = static_cast<uint32_t>(offset);
+  num_swizzled_ += 1;
+  return page;
+}
+
+auto BufferPoolManager::FetchPageReadSwip(page_id_t parent_id, Swip *swip) -> ReadPageGuard {
+  Page *page = FetchPageSwip(parent_id, swip);
+  if (page == nullptr) {
+    return {this, nullptr};
+  }
+  page->RLatch();
+  return {this, page};
+}
+
+auto BufferPoolManager::FetchPageWriteSwip(page_id_t parent_id, Swip *swip) -> WritePageGuard {
+  Page *page = FetchPageSwip(parent_id, swip);
   if (page == nullptr) {
     return {this, nullptr};
   }
@@ -191,4 +1216,21 @@ auto BufferPoolManager::FetchPageWrite(page_id_t page_id) -> WritePageGuard {
   return {this, page};
 }
 
-auto BufferPoolManager::NewPageGuarded(page_id_t *page_id) -> BasicPageGuard { return {this, NewPage(page_id)}; }
+void BufferPoolManager::UnswizzleSwip(page_id_t parent_id, Swip *swip) {
+  std::scoped_lock scoped_lock(latch_);
+  frame_id_t parent_frame = page_table_.Find(parent_id);
+  if (parent_frame == PageTable::NO_FRAME || !swip->IsSwizzled()) {
+    return;
+  }
+  Page *parent = &pages_[parent_frame];
+  auto offset = static_cast<uint32_t>(reinterpret_cast<char *>(swip) - parent->data_);
+  if (std::find(parent->swizzled_swips_.begin(), parent->swizzled_swips_.end(), offset) ==
+      parent->swizzled_swips_.end()) {
+    return;
+  }
+  DetachSwip(Swip::PageOf(swip->value_.load(std::memory_order_relaxed)));
+}
+
+auto BufferPoolManager::NewPageGuarded(page_id_t *page_id, tenant_id_t tenant) -> BasicPageGuard {
+  return {this, NewPage(page_id, tenant)};
+}
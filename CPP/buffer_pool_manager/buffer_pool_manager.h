@@ -1,14 +1,45 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <future>              // NOLINT
 #include <list>
 #include <memory>
-#include <mutex>  // NOLINT
+#include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "compressed_page_cache.h"
+#include "count_min_sketch.h"
+#include "dirty_range_set.h"
 #include "lru_k_replacer.h"
 #include "disk_manager.h"
+#include "lock_profiler.h"
+#include "log_manager.h"
 #include "page.h"
 #include "page_guard.h"
+#include "page_table.h"
+#include "swip.h"
+#include "thread_pin_cache.h"
+
+/** How long the background evictor waits before trying again when it found nothing to evict. */
+static constexpr std::chrono::milliseconds EVICTOR_BACKOFF{10};
+
+/** How many more passes a write-back makes over the pages whose latch was busy before it leaves them dirty. */
+static constexpr int WRITE_BACK_RETRIES = 3;
+
+/** Per-tenant buffer pool statistics. */
+struct TenantStats {
+  /** Number of FetchPage calls served from the buffer pool. */
+  size_t hits_{0};
+  /** Number of FetchPage calls that had to read the page from disk. */
+  size_t misses_{0};
+  /** Number of frames currently charged to the tenant. */
+  size_t frames_{0};
+};
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
@@ -20,7 +51,8 @@ class BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param replacer_k the lookback constant k for the LRU-K replacer
-   * @param log_manager the log manager (for testing only: nullptr = disable logging). Please ignore this for P1.
+   * @param log_manager the log manager (nullptr = disable logging). When set, a dirty page is never written back
+   * before the log is durable up to its LSN.
    */
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t replacer_k = LRUK_REPLACER_K,
                     LogManager *log_manager = nullptr);
@@ -41,9 +73,28 @@ class BufferPoolManager {
    * are currently in use and not evictable (in another word, pinned).
    * 
    * @param[out] page_id id of created page
+   * @param tenant the tenant the page's frame is charged to
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  auto NewPage(page_id_t *page_id) -> Page *;
+  auto NewPage(page_id_t *page_id, tenant_id_t tenant = DEFAULT_TENANT) -> Page *;
+
+  /**
+   * @brief Create a new page of the given size class, so that a large object fits in one page instead of a chain.
+   *
+   * Frames hold a page of any size class, and each frame's buffer is sized to its page. All buffers come out of one
+   * memory budget of GetPoolSize() * BUSTUB_PAGE_SIZE bytes, the memory the pool would take with only 4 KiB pages:
+   * when a page needs more memory than is left, pages are evicted until it fits, free frames' buffers first. A
+   * page of a larger class takes PagesInClass(size_class) consecutive page ids on disk, and FetchPage reads and
+   * writes it whole. The size class is recorded through DiskManager::WriteSizeClass before the page can reach the
+   * disk, and read back when the pool is created, so a large page is still read whole after a restart.
+   *
+   * @param[out] page_id id of created page
+   * @param size_class size class of the page
+   * @param tenant the tenant the page's frame is charged to
+   * @return nullptr if no frame or not enough memory could be freed, or if the disk manager could not allocate
+   * the page ids, otherwise pointer to new page
+   */
+  auto NewPage(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant = DEFAULT_TENANT) -> Page *;
 
   /**
    * @brief PageGuard wrapper for NewPage
@@ -53,9 +104,24 @@ class BufferPoolManager {
    * BasicPageGuard structure.
    *
    * @param[out] page_id, the id of the new page
+   * @param tenant the tenant the page's frame is charged to
    * @return BasicPageGuard holding a new page
    */
-  auto NewPageGuarded(page_id_t *page_id) -> BasicPageGuard;
+  auto NewPageGuarded(page_id_t *page_id, tenant_id_t tenant = DEFAULT_TENANT) -> BasicPageGuard;
+
+  /**
+   * @brief Create a new page like NewPage, but without zeroing its data.
+   *
+   * For callers that lay out the whole page themselves right away, e.g. when building index nodes during a bulk
+   * load, zeroing it first is wasted work. The data is whatever the frame last held: the caller has to
+   * initialize every byte it will rely on, including the LSN, and should overwrite the rest too, since the whole
+   * page is written back.
+   *
+   * @param[out] page_id id of created page
+   * @param tenant the tenant the page's frame is charged to
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPageUninitialized(page_id_t *page_id, tenant_id_t tenant = DEFAULT_TENANT) -> Page *;
 
   /**
    * @brief Fetch the requested page from the buffer pool. Return nullptr if page_id needs to be fetched from the disk
@@ -63,9 +129,11 @@ class BufferPoolManager {
    * 
    * @param page_id id of page to be fetched
    * @param access_type type of access to the page, only needed for leaderboard tests.
+   * @param tenant the tenant the access is accounted to, and the page's frame is charged to on a miss
    * @return nullptr if page_id cannot be fetched, otherwise pointer to the requested page
    */
-  auto FetchPage(page_id_t page_id, AccessType access_type = AccessType::Unknown) -> Page *;
+  auto FetchPage(page_id_t page_id, AccessType access_type = AccessType::Unknown,
+                 tenant_id_t tenant = DEFAULT_TENANT) -> Page *;
 
   /**
    * @brief PageGuard wrappers for FetchPage
@@ -75,12 +143,32 @@ class BufferPoolManager {
    * If FetchPageRead or FetchPageWrite is called, it is expected that
    * the returned page already has a read or write latch held, respectively.
    *
+   * Page latches prefer writers, so a thread must not fetch a page for read while it already holds it read- or
+   * write-latched: a writer queued in between would deadlock with it.
+   *
    * @param page_id, the id of the page to fetch
+   * @param tenant the tenant the access is accounted to
    * @return PageGuard holding the fetched page
    */
-  auto FetchPageBasic(page_id_t page_id) -> BasicPageGuard;
-  auto FetchPageRead(page_id_t page_id) -> ReadPageGuard;
-  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard;
+  auto FetchPageBasic(page_id_t page_id, tenant_id_t tenant = DEFAULT_TENANT) -> BasicPageGuard;
+  auto FetchPageRead(page_id_t page_id, tenant_id_t tenant = DEFAULT_TENANT) -> ReadPageGuard;
+  auto FetchPageWrite(page_id_t page_id, tenant_id_t tenant = DEFAULT_TENANT) -> WritePageGuard;
+
+  /**
+   * @brief Fetch a set of pages and write-latch all of them, for operations that modify several pages at once.
+   *
+   * The pages already in the pool are pinned in a single critical section of the pool latch, the others are then
+   * read in one by one. Only once every page is pinned are the latches acquired, in ascending page id order, so
+   * two threads latching overlapping sets this way can never deadlock. This only holds against other code that
+   * latches several pages in the same order: the caller must not already hold a page latch while calling it.
+   *
+   * @param page_ids ids of the pages to fetch, duplicates are latched once
+   * @param tenant the tenant the accesses are accounted to
+   * @return the guard holding every page, or an empty guard if one of them could not be fetched, in which case
+   * none is held
+   */
+  auto FetchPagesWrite(const std::vector<page_id_t> &page_ids, tenant_id_t tenant = DEFAULT_TENANT)
+      -> MultiPageGuard;
 
   /**
    * @brief Unpin the target page from the buffer pool. If page_id is not in the buffer pool or its pin count is already
@@ -96,6 +184,16 @@ class BufferPoolManager {
    */
   auto UnpinPage(page_id_t page_id, bool is_dirty, AccessType access_type = AccessType::Unknown) -> bool;
 
+  /**
+   * @brief Unpin the target page, recording which of its bytes were modified. The page is marked dirty if any
+   * were, and written back as a delta if the disk manager supports it and the modification is small enough.
+   *
+   * @param page_id id of page to be unpinned
+   * @param modified the byte ranges modified while the page was pinned
+   * @return false if the page is not in the page table or its pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinPage(page_id_t page_id, const DirtyRangeSet &modified) -> bool;
+
   /**
    * @brief Flush the target page to disk.
    *
@@ -108,19 +206,265 @@ class BufferPoolManager {
   auto FlushPage(page_id_t page_id) -> bool;
 
   /**
-   * @brief Flush all the pages in the buffer pool to disk.
+   * @brief Flush all the dirty pages in the buffer pool to disk.
+   *
+   * The dirty pages are sorted by page id and split into contiguous ranges, one per I/O thread (see
+   * SetFlushThreads), which write them back without holding the pool latch. Returns after all the writes and a
+   * single DiskManager::Sync have completed.
+   *
+   * Each page is copied under its read latch, which is only tried: a page that stays latched for write, for
+   * example by the caller's own WritePageGuard, is left dirty after a few passes rather than waited for.
    */
   void FlushAllPages();
 
+  /**
+   * @brief Set the number of threads FlushAllPages and Checkpoint use to write pages back.
+   * @param flush_threads number of I/O threads, including the calling thread
+   */
+  void SetFlushThreads(size_t flush_threads) { flush_threads_ = std::max<size_t>(1, flush_threads); }
+
+  /**
+   * @brief Start the background evictor, which keeps at least free_reserve frames on the free list.
+   *
+   * Whenever a frame taken from the free list leaves fewer than free_reserve behind, the evictor evicts victims
+   * from the replacer ahead of demand, so that a miss usually just pops a free frame instead of evicting, and
+   * possibly writing, inline. The evictor only peeks at the replacer's victims, honoring tenant quotas, and
+   * evicts just the clean ones, which go to the free list right away. Dirty victims stay in their frames, pinned,
+   * and keep their replacer state while the evictor writes them back without holding the pool latch; they are
+   * freed on the next round, unless they were used again meanwhile.
+   *
+   * @param free_reserve number of free frames to maintain, a few percent of the pool is typical
+   */
+  void RunEvictorThread(size_t free_reserve);
+
+  /** @brief Stop the background evictor. */
+  void StopEvictorThread();
+
+  /** @return the number of frames the background evictor has freed */
+  auto GetBackgroundEvictions() -> size_t { return background_evictions_; }
+
+  /**
+   * @brief Take a fuzzy checkpoint without stopping the world.
+   *
+   * The dirty pages and their recovery LSNs are snapshotted under the latch, then written back in page-id order
+   * with the latch released, in parallel like FlushAllPages, so traffic continues while the checkpoint runs. Each
+   * page is pinned and copied under its read latch, and only marked clean if no change was reported during the
+   * write. Pages that were written back by someone else in the meantime are skipped. Then the minimum recovery LSN
+   * over the pages that are still dirty is taken, and the disk manager is synced, which makes every write that
+   * LSN vouches for durable, evictions included. Only then is a CheckpointRecord carrying it appended and made
+   * durable, which bounds the redo work of recovery. A page whose latch stays busy, as with FlushAllPages, is
+   * left dirty and keeps holding the recovery LSN back.
+   *
+   * @return the minimum recovery LSN recorded by the checkpoint (0 without a log manager)
+   */
+  auto Checkpoint() -> lsn_t;
+
+  /** @brief Run Checkpoint on a background thread. */
+  auto CheckpointAsync() -> std::future<lsn_t> {
+    return std::async(std::launch::async, [this] { return Checkpoint(); });
+  }
+
   /**
    * @brief Delete a page from the buffer pool. If page_id is not in the buffer pool, do nothing and return true. If the
-   * page is pinned and cannot be deleted, return false immediately.
+   * page is pinned and cannot be deleted, return false immediately. The same goes for a page reachable through a
+   * swizzled swip in a parent that is currently latched.
    *
    * @param page_id id of page to be deleted
    * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
    */
   auto DeletePage(page_id_t page_id) -> bool;
 
+  /** @return the number of evictions that picked a clean frame instead of a dirty one ranked ahead of it */
+  auto GetDirtyEvictionsAvoided() -> size_t { return replacer_->GetDirtyEvictionsAvoided(); }
+
+  /**
+   * @brief Use an open-addressing hash table instead of the direct-mapped array as the page table.
+   *
+   * The direct-mapped table costs memory proportional to the highest page id in the pool, which suits the dense
+   * ids handed out by AllocatePage. When page ids are sparse, e.g. assigned by the disk manager or recycled from
+   * a large id space, the hash table keeps the page table at a fixed size of a few words per frame. Should be
+   * called before the pool is used.
+   */
+  void EnableHashedPageTable();
+
+  /**
+   * @brief Zero new pages with non-temporal stores.
+   *
+   * NewPage zeroes the page with ordinary stores by default, which reads every line of the frame into the cache
+   * first. With streaming stores the zeroes go straight to memory, so allocating many pages in a row, as a bulk
+   * load does, doesn't evict the hot pages' lines; the price is a cache miss on the first access to each new
+   * page. Deleted and evicted frames are never zeroed eagerly, only when they are reused by NewPage.
+   */
+  void EnableStreamingZeroFill() { streaming_zero_fill_ = true; }
+
+  /**
+   * @brief Enable the W-TinyLFU admission filter in front of the replacer.
+   *
+   * Every FetchPage records the page in a Count-Min sketch. When a miss would evict a frame, the requested page
+   * is compared with the replacer's victim by estimated frequency: if it is not hotter, it goes to a small
+   * probation window whose frames are recycled among themselves, so one-hit-wonders can't displace the hot set.
+   * A second access to a page in the window admits it to the main area. The window never grows past its size: if
+   * none of its frames can be recycled, say because they are all pinned, the page is admitted right away. Should
+   * be called before the pool is used.
+   *
+   * @param window_size maximum number of frames in the probation window, around 1% of the pool is typical
+   */
+  void EnableAdmissionFilter(size_t window_size);
+
+  /**
+   * @brief Enable pointer swizzling for FetchPageSwip.
+   *
+   * Following a swip that holds a page id fetches the page as usual and then swizzles the swip, replacing the id
+   * with a pointer to the frame. Later traversals through it pin the frame directly, without the page table
+   * lookup. A swizzled swip does not pin its target: each frame remembers the one swip that points at it, and
+   * when the replacer picks the frame the swip is unswizzled first, which needs the parent's write latch. If the
+   * parent is latched, the victim gets a second chance and the replacer moves on. The parent's swips are
+   * unswizzled when the parent is evicted or deleted, and every image of the parent written to disk has them
+   * unswizzled. Should be called before the pool is used.
+   *
+   * @param max_swizzled maximum number of swips swizzled at the same time; swips followed past the limit are
+   * resolved through the page table and left unswizzled
+   */
+  void EnableSwizzling(size_t max_swizzled) { max_swizzled_ = max_swizzled; }
+
+  /**
+   * @brief Fetch the page a swip in another page refers to, swizzling the swip if swizzling is enabled.
+   *
+   * The caller has to hold the parent page pinned and latched, which keeps the targets of the swizzled pointers in
+   * it from being evicted.
+   * A swizzled swip must not be overwritten or moved: unswizzle it first with UnswizzleSwip.
+   *
+   * @param parent_id id of the page that holds the swip
+   * @param swip the swip, inside the parent's data
+   * @return the referenced page, pinned, or nullptr if it could not be fetched
+   */
+  auto FetchPageSwip(page_id_t parent_id, Swip *swip) -> Page *;
+
+  /** @brief FetchPageSwip, read-latched. */
+  auto FetchPageReadSwip(page_id_t parent_id, Swip *swip) -> ReadPageGuard;
+
+  /** @brief FetchPageSwip, write-latched. */
+  auto FetchPageWriteSwip(page_id_t parent_id, Swip *swip) -> WritePageGuard;
+
+  /**
+   * @brief Turn a swizzled swip back into a page id. The caller has to hold the parent write-latched. Does
+   * nothing if the swip is not swizzled.
+   *
+   * @param parent_id id of the page that holds the swip
+   * @param swip the swip, inside the parent's data
+   */
+  void UnswizzleSwip(page_id_t parent_id, Swip *swip);
+
+  /**
+   * @brief Enable a per-thread cache of deferred unpins.
+   *
+   * Unpinning a page does not release the pin but parks it in a tiny table local to the calling thread, and
+   * fetching the page again on that thread takes the parked pin back without touching the pool latch, the page
+   * table or the replacer. Unpinning still checks under the latch that the caller holds a pin that is not parked
+   * already, and reports modifications right away so that flushes and checkpoints see them; only the pin release
+   * is deferred. Parked pins are released when the table needs room, by FlushPinCache, and when the thread exits.
+   *
+   * A parked pin keeps its page from being evicted, so up to max_entries frames per thread stay pinned: size the
+   * pool accordingly. When a fetch or NewPage on a thread finds no free frame, the thread releases its parked
+   * pins and tries again. DeletePage and FlushAllPages release the pins every thread has parked, of the page or of
+   * the whole pool.
+   * Fetches served from the cache are not counted as hits, nor seen by the replacer. Should be called before the
+   * pool is used.
+   *
+   * @param max_entries most pages a thread keeps pinned, at most ThreadPinCache::MAX_ENTRIES
+   */
+  void EnableThreadPinCache(size_t max_entries);
+
+  /**
+   * @brief Release the pins the calling thread has parked in its pin cache.
+   * @return the number of pins released
+   */
+  auto FlushPinCache() -> size_t;
+
+  /** @return the number of swips currently swizzled */
+  auto GetNumSwizzled() -> size_t { return num_swizzled_; }
+
+  /**
+   * @brief Make a page permanently resident, for pages such as index roots or catalog pages that are needed on
+   * nearly every request.
+   *
+   * The page is brought into the pool if needed and its frame is taken out of replacement: it is never evicted,
+   * and fetching it again skips the replacer's access recording. The returned pointer stays valid until
+   * ReleaseResident, so hot readers can latch it directly instead of going through FetchPage. Changes must still be
+   * made through FetchPageWrite (or FetchPage + UnpinPage) so that the page is marked dirty.
+   *
+   * At most GetMaxResidentFrames() frames can be resident at the same time.
+   *
+   * @param page_id id of page to make resident
+   * @return pointer to the resident page, nullptr if the page could not be fetched or the resident set is full
+   */
+  auto MakeResident(page_id_t page_id) -> Page *;
+
+  /**
+   * @brief Return a resident page to normal replacement.
+   * @param page_id id of the resident page
+   * @return false if the page is not resident, true otherwise
+   */
+  auto ReleaseResident(page_id_t page_id) -> bool;
+
+  /** @brief Set how many frames may be reserved for resident pages, defaults to a quarter of the pool. */
+  void SetMaxResidentFrames(size_t max_resident_frames) {
+    std::scoped_lock scoped_lock(latch_);
+    max_resident_frames_ = max_resident_frames;
+  }
+
+  /** @return how many frames may be reserved for resident pages */
+  auto GetMaxResidentFrames() -> size_t {
+    std::scoped_lock scoped_lock(latch_);
+    return max_resident_frames_;
+  }
+
+  /**
+   * @brief Set the frame quota of a tenant, enforced by the replacer. Tenants without a quota are unrestricted.
+   *
+   * Other tenants can't evict the tenant below `min_frames`, and once it holds `max_frames` frames its misses can
+   * only replace its own pages, so one tenant's scan can't flush everyone else's working set.
+   *
+   * @param tenant the tenant
+   * @param min_frames number of frames reserved for the tenant
+   * @param max_frames maximum number of frames the tenant may hold
+   */
+  void SetTenantQuota(tenant_id_t tenant, size_t min_frames, size_t max_frames) {
+    replacer_->SetTenantQuota(tenant, min_frames, max_frames);
+  }
+
+  /** @return hit/miss statistics and current frame usage of the tenant */
+  auto GetTenantStats(tenant_id_t tenant) -> TenantStats;
+
+  /**
+   * @brief Enable the compressed victim tier between the pool and the disk.
+   *
+   * Evicted pages are kept LZ-compressed within `budget_bytes` of memory, and FetchPage consults the tier before
+   * DiskManager::ReadPage, so compressible pages effectively get a larger cache. Eviction only copies a page into
+   * the tier, it is compressed after the latch is released. Should be called before the pool is used.
+   *
+   * @param budget_bytes memory budget of the tier, in bytes of page data, compressed or waiting to be
+   */
+  void EnableCompressedCache(size_t budget_bytes);
+
+  /** @return the compressed victim tier, nullptr if it is disabled */
+  auto GetCompressedCache() -> CompressedPageCache * { return compressed_cache_.get(); }
+
+  /** @return the number of FetchPage calls served from the buffer pool */
+  auto GetHitCount() -> size_t { return hit_count_; }
+
+  /** @return the number of FetchPage calls that had to read the page from disk */
+  auto GetMissCount() -> size_t { return miss_count_; }
+
+  /** @return the number of fetched pages the admission filter sent to the probation window */
+  auto GetAdmissionRejections() -> size_t { return admission_rejections_; }
+
+  /** @return the bytes of page buffers the frames hold, at most GetPoolSize() * BUSTUB_PAGE_SIZE */
+  auto GetMemoryUsed() -> size_t {
+    std::scoped_lock scoped_lock(latch_);
+    return memory_used_;
+  }
+
  private:
   /** Number of pages in the buffer pool. */
   const size_t pool_size_;
@@ -130,30 +474,311 @@ class BufferPoolManager {
   /** Array of buffer pool pages. */
   Page *pages_;
   /** Pointer to the disk manager. */
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  /** Pointer to the log manager. Please ignore this for P1. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
+  /** Pointer to the log manager, nullptr if logging is disabled. */
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  PageTable page_table_;
   /** Replacer to find unpinned pages for replacement. */
   std::unique_ptr<LRUKReplacer> replacer_;
   /** List of free frames that don't have any pages on them. */
   std::list<frame_id_t> free_list_;
+  /** Compressed second-level cache of evicted pages, nullptr if disabled. */
+  std::unique_ptr<CompressedPageCache> compressed_cache_;
+  /** Frequency sketch of the TinyLFU admission filter, nullptr if the filter is disabled. */
+  std::unique_ptr<CountMinSketch> admission_sketch_;
+  /** Maximum number of frames in the probation window of the admission filter. */
+  size_t admission_window_{0};
+  /** Number of frames currently holding resident pages, and the upper bound for it. */
+  size_t resident_frames_{0};
+  size_t max_resident_frames_;
+  /** Maximum number of swips swizzled at the same time, 0 if swizzling is disabled. */
+  size_t max_swizzled_{0};
+  /** True if NewPage zeroes pages with non-temporal stores. */
+  bool streaming_zero_fill_{false};
+  /** Bytes the frames' buffers may take, and take now. */
+  const size_t memory_budget_;
+  size_t memory_used_;
+  /**
+   * Size class of every page that is larger than BUSTUB_PAGE_SIZE, the others are not listed. A copy of the disk
+   * manager's size class records.
+   */
+  std::unordered_map<page_id_t, PageSizeClass> page_size_classes_;
+  std::atomic<size_t> num_swizzled_{0};
+  /** Identifies the pool in thread pin caches, unlike its address it is never reused. */
+  const uint64_t serial_;
+  /** Most pages a thread may keep in its pin cache, 0 if the pin cache is disabled. */
+  size_t max_pin_cache_entries_{0};
+  /** Number of threads FlushAllPages and Checkpoint write pages back with. */
+  size_t flush_threads_{1};
+  /** Hit/miss statistics of every tenant that has accessed the pool, frames_ is filled in on demand. */
+  std::unordered_map<tenant_id_t, TenantStats> tenant_stats_;
+  /** Hits of the default tenant served by PinLatchFree, which leaves tenant_stats_ alone. */
+  std::atomic<size_t> latch_free_hits_{0};
+  std::atomic<size_t> hit_count_{0};
+  std::atomic<size_t> miss_count_{0};
+  std::atomic<size_t> admission_rejections_{0};
+  std::atomic<size_t> background_evictions_{0};
+  /** Number of free frames the background evictor maintains. */
+  size_t free_reserve_{0};
+  bool stop_evictor_{false};
+  std::unique_ptr<std::thread> evictor_thread_;
+  /** Wakes up the evictor when the free list runs low. */
+  ProfiledConditionVariable evictor_cv_;
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  ProfiledMutex<LockSite::BufferPool> latch_;
 
   /**
    * @brief Allocate a page on disk. Caller should acquire the latch before calling this function.
-   * @return the id of the allocated page
+   *
+   * Page ids come from the disk manager if it manages them, so that it can place new pages in preallocated
+   * extents and reuse deallocated ones, and from a counter otherwise.
+   *
+   * A page of a larger size class needs consecutive ids, which DiskManager::AllocatePages hands out as a run.
+   *
+   * @param num_pages number of consecutive ids to allocate
+   * @return the id of the allocated page, the first of them, or INVALID_PAGE_ID if the disk manager has no run
+   * of that length
+   */
+  auto AllocatePage(size_t num_pages = 1) -> page_id_t;
+
+  /** The calling thread's pin cache, which hands leftover pins back to their pools when the thread exits. */
+  struct LocalPinCache;
+
+  /** @return the calling thread's pin cache */
+  static auto GetPinCache() -> ThreadPinCache &;
+
+  /**
+   * @brief NewPage or NewPageUninitialized.
+   * @param zero true to zero the page's data
+   */
+  auto CreatePage(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant, bool zero) -> Page *;
+
+  /** @brief CreatePage, bypassing the pin cache. */
+  auto NewPageShared(page_id_t *page_id, PageSizeClass size_class, tenant_id_t tenant, bool zero) -> Page *;
+
+  /**
+   * @brief Compress the pages evicted into the compressed tier, see EvictPage. Caller must not hold the latch, so
+   * that the compression doesn't stall other threads.
+   */
+  void CompressEvicted();
+
+  /**
+   * @brief Pin a page that is in the pool, accounting the access as a hit. Caller should acquire the latch before
+   * calling this function.
+   * @param frame_id the frame holding the page
+   * @param tenant the tenant the access is accounted to
+   * @return the pinned page
+   */
+  auto PinHit(frame_id_t frame_id, tenant_id_t tenant) -> Page *;
+
+  /**
+   * @brief Pin a page that is in the pool and already pinned, without taking the latch: the page table lookup is
+   * lock-free, and the pin count is raised only if it is not zero, so the frame can't be evicted meanwhile. Only
+   * serves the default tenant without an admission filter, whose bookkeeping needs the latch.
+   * @param page_id id of the page
+   * @param tenant the tenant the access is accounted to
+   * @return the pinned page, nullptr if the caller has to go through the latch
+   */
+  auto PinLatchFree(page_id_t page_id, tenant_id_t tenant) -> Page *;
+
+  /** @brief FetchPage, bypassing the pin cache. */
+  auto FetchPageShared(page_id_t page_id, tenant_id_t tenant) -> Page *;
+
+  /**
+   * @brief UnpinPage, bypassing the pin cache.
+   * @param page_id id of page to be unpinned
+   * @param modified the byte ranges modified while the page was pinned
+   * @param[out] parked if not nullptr, the pin is counted as parked instead of released, and the page it
+   * belongs to is returned here for the caller to put in its pin cache
+   */
+  auto UnpinPageShared(page_id_t page_id, const DirtyRangeSet &modified, Page **parked) -> bool;
+
+  /** @brief Take a pin back from the calling thread's pin cache, nullptr if none of the page is parked. */
+  auto TakeParkedPin(page_id_t page_id) -> Page *;
+
+  /** @brief Release pins taken back from a pin cache. */
+  void ReleasePins(page_id_t page_id, uint32_t pins);
+
+  /**
+   * @brief Release the pins of this pool that any thread has parked in its pin cache.
+   * @param page_id only release the pins of this page, or all of them for INVALID_PAGE_ID
+   */
+  void DrainPinCaches(page_id_t page_id = INVALID_PAGE_ID);
+
+  /**
+   * @brief Find a frame for a page that is about to be brought into the pool. Caller should acquire the latch
+   * before calling this function.
+   *
+   * The free list is used first, then the replacer. With the admission filter enabled, a candidate that is not
+   * hotter than the replacer's victim recycles a probation frame instead (once the window is full).
+   *
+   * Tenant quotas apply: a tenant at its maximum does not get free frames and can only replace its own pages.
+   *
+   * @param candidate id of the page that will occupy the frame, INVALID_PAGE_ID for new pages which are always admitted
+   * @param tenant the tenant the frame is going to be charged to
+   * @param[out] frame_id the frame to use, its old content is not written out yet
+   * @param[out] probation true if the page should be placed in the probation window
+   * @param[out] wait_lsn set if the victim's log records are not durable yet, see EvictVictim
+   * @return false if no frame is available
    */
-  auto AllocatePage() -> page_id_t;
+  auto AcquireFrame(page_id_t candidate, tenant_id_t tenant, frame_id_t *frame_id, bool *probation, lsn_t *wait_lsn)
+      -> bool;
 
   /**
-   * @brief Deallocate a page on disk. Caller should acquire the latch before calling this function.
+   * @brief Evict the replacer's victim, unless it is dirty and its log records are not durable yet: writing it back
+   * would have to wait for the log with the latch held. The caller releases the latch, waits for `wait_lsn` and
+   * tries again instead. Caller should acquire the latch before calling this function.
+   * @param tenant the tenant the freed frame is going to be charged to
+   * @param probation_only only evict a probation frame, see LRUKReplacer::EvictProbation
+   * @param[out] frame_id the evicted frame
+   * @param[out] wait_lsn the LSN to wait for, only set if the victim was left alone because of it
+   * @return false if no frame was evicted
+   */
+  auto EvictVictim(tenant_id_t tenant, bool probation_only, frame_id_t *frame_id, lsn_t *wait_lsn) -> bool;
+
+  /**
+   * @brief Get rid of the page held by a frame that is about to be reused: write it out if it is dirty, hand it
+   * to the compressed tier and remove it from the page table. Caller should acquire the latch before calling
+   * this function.
+   * @param frame_id the victim frame, free frames are left alone
+   */
+  void EvictPage(frame_id_t frame_id);
+
+  /**
+   * @brief Write a page back to disk, after making sure the log is durable up to the page LSN (write-ahead logging).
+   * Does not touch the dirty flag.
+   * @param page the page to write
+   */
+  void WritePageToDisk(Page *page);
+
+  /** @return the page ids and recovery LSNs of the dirty pages in the pool */
+  auto SnapshotDirtyPages() -> std::vector<std::pair<page_id_t, lsn_t>>;
+
+  /**
+   * @brief Write back a snapshot of dirty pages, split by page-id range across flush_threads_ threads.
+   * @param dirty_pages the snapshot taken by SnapshotDirtyPages
+   */
+  void WriteBackPages(std::vector<std::pair<page_id_t, lsn_t>> dirty_pages);
+
+  /** @brief Body of the background evictor. */
+  void EvictorThreadLoop();
+
+  /**
+   * @brief Free frames up to the reserve: clean victims go to the free list, dirty ones are written back first.
+   * @param lock the held pool latch, released while writing
+   * @return the number of frames freed
+   */
+  auto RefillFreeList(std::unique_lock<ProfiledMutex<LockSite::BufferPool>> *lock) -> size_t;
+
+  /**
+   * @brief Write back the pages of one range of a sorted snapshot. Pages whose latch is busy are retried up to
+   * WRITE_BACK_RETRIES more times, then left dirty.
+   */
+  void WriteBackRange(const std::pair<page_id_t, lsn_t> *begin, const std::pair<page_id_t, lsn_t> *end);
+
+  /**
+   * @brief Write back one page of a snapshot. The page is pinned and copied under its read latch, written without
+   * holding the pool latch, and only marked clean if it was not dirtied again meanwhile. Pages that left the pool
+   * or were flushed since the snapshot are skipped.
+   * @param page_id id of the page
+   * @param rec_lsn recovery LSN of the page in the snapshot
+   * @param buffer scratch space for the copy, grown as needed
+   * @param buffer_size size of buffer
+   * @return false if the page's latch was busy and nothing was written, true otherwise
+   */
+  auto WriteBackPage(page_id_t page_id, lsn_t rec_lsn, std::unique_ptr<char[]> *buffer, size_t *buffer_size) -> bool;
+
+  /**
+   * @brief Write a page image to disk, as a delta unless the whole page is dirty or the page is larger than
+   * BUSTUB_PAGE_SIZE. A delta always includes the page header, which holds the page LSN.
+   * @param page_id id of the page
+   * @param size_class size class of the page
+   * @param data the page image
+   * @param dirty_ranges bytes modified since the page was last written
+   */
+  void WriteImage(page_id_t page_id, PageSizeClass size_class, const char *data, const DirtyRangeSet &dirty_ranges);
+
+  /**
+   * @brief Replace the swizzled swips of a page in an image of it with page ids. Caller should acquire the latch
+   * before calling this function.
+   * @param page the page the image was taken from
+   * @param image a copy of the page's data
+   */
+  void UnswizzleImage(Page *page, char *image);
+
+  /**
+   * @brief Unswizzle every swip of a page that is leaving the pool. Caller should acquire the latch before calling
+   * this function.
+   * @param page the page, unpinned
+   */
+  void UnswizzleAll(Page *page);
+
+  /**
+   * @brief Unswizzle the swip that points at a page, if its parent's write latch can be taken without waiting.
+   * Caller should acquire the latch before calling this function.
+   * @param page the swip's target, which has a swip_parent_
+   * @return false if the parent is latched, and the swip may be in use
+   */
+  auto UnswizzleParentSwip(Page *page) -> bool;
+
+  /**
+   * @brief Turn the swip that points at a page back into a page id and drop the back reference. Caller should
+   * acquire the latch and hold the parent write-latched before calling this function.
+   * @param page the swip's target, which has a swip_parent_
+   */
+  void DetachSwip(Page *page);
+
+  /**
+   * @brief Mark a page as identical to its on-disk image. Caller should acquire the latch before calling this
+   * function.
+   * @param page the page
+   * @param rec_lsn NextLSN() as of when the written image was taken, any change logged later is not in it
+   */
+  void MarkClean(Page *page, lsn_t rec_lsn);
+
+  /** @return the LSN the next log record will get, 0 if logging is disabled */
+  auto NextLSN() -> lsn_t { return log_manager_ == nullptr ? 0 : log_manager_->GetNextLSN(); }
+
+  /**
+   * @brief Deallocate a page on disk, every id it spans. Caller should acquire the latch before calling this
+   * function.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
+  void DeallocatePage(page_id_t page_id);
+
+  /** @return the size class of a page. Caller should acquire the latch before calling this function. */
+  auto SizeClassOf(page_id_t page_id) -> PageSizeClass {
+    if (page_size_classes_.empty()) {
+      return PageSizeClass::Size4K;
+    }
+    auto it = page_size_classes_.find(page_id);
+    return it == page_size_classes_.end() ? PageSizeClass::Size4K : it->second;
   }
 
+  /**
+   * @brief Give a frame taken for a new page a buffer of the page's size class. Caller should acquire the latch
+   * before calling this function.
+   *
+   * The frame keeps its buffer if it is of the right class, and otherwise trades it for the buffer of a free
+   * frame of the right class if there is one. Only then is a new buffer allocated, after freeing enough memory
+   * for it: free frames give up their buffers first, then pages are evicted, as the tenant's quota allows.
+   *
+   * @param frame_id the frame, which holds no page
+   * @param size_class size class of the page about to occupy the frame
+   * @param tenant the tenant the page's frame is charged to
+   * @param[out] wait_lsn set if a page could not be evicted yet because of its log records, see EvictVictim
+   * @return false if not enough memory could be freed, the frame is back on the free list then
+   */
+  auto PrepareFrame(frame_id_t frame_id, PageSizeClass size_class, tenant_id_t tenant, lsn_t *wait_lsn) -> bool;
+
+  /**
+   * @brief Free the buffer of one frame, a free frame's if any has one, otherwise an evicted page's. Caller should
+   * acquire the latch before calling this function.
+   * @param tenant the tenant on whose behalf a page may be evicted
+   * @param[out] wait_lsn set if the victim could not be evicted yet because of its log records, see EvictVictim
+   * @return false if there was nothing to free
+   */
+  auto ReleaseFrameMemory(tenant_id_t tenant, lsn_t *wait_lsn) -> bool;
+
 };
@@ -0,0 +1,83 @@
+#include "checksum_disk_manager.h"
+
+#include <memory>
+#include <string>
+
+#include "crc32c.h"
+#include "page.h"
+
+auto ChecksumDiskManager::ComputeChecksum(const char *page_data, size_t size) -> uint32_t {
+  constexpr size_t checksum_end = Page::OFFSET_CHECKSUM + sizeof(uint32_t);
+  return Crc32c::Compute(page_data + checksum_end, size - checksum_end);
+}
+
+auto ChecksumDiskManager::VerifyChecksum(const char *page_data, size_t size) -> bool {
+  uint32_t stored;
+  memcpy(&stored, page_data + Page::OFFSET_CHECKSUM, sizeof(stored));
+  if (stored == ComputeChecksum(page_data, size)) {
+    return true;
+  }
+  // A page that was never written has no checksum, it is only valid if it is all zeroes
+  if (stored != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    if (page_data[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ChecksumDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  char buffer[BUSTUB_PAGE_SIZE];
+  memcpy(buffer, page_data, BUSTUB_PAGE_SIZE);
+  uint32_t checksum = ComputeChecksum(buffer);
+  memcpy(buffer + Page::OFFSET_CHECKSUM, &checksum, sizeof(checksum));
+  disk_manager_->WritePage(page_id, buffer);
+  num_writes_ += 1;
+}
+
+void ChecksumDiskManager::WritePageDelta(page_id_t page_id, const char *page_data,
+                                         const DirtyRangeSet &dirty_ranges) {
+  char buffer[BUSTUB_PAGE_SIZE];
+  memcpy(buffer, page_data, BUSTUB_PAGE_SIZE);
+  uint32_t checksum = ComputeChecksum(buffer);
+  memcpy(buffer + Page::OFFSET_CHECKSUM, &checksum, sizeof(checksum));
+  DirtyRangeSet stamped_ranges = dirty_ranges;
+  stamped_ranges.Add(Page::OFFSET_CHECKSUM, Page::OFFSET_CHECKSUM + sizeof(checksum));
+  disk_manager_->WritePageDelta(page_id, buffer, stamped_ranges);
+  num_writes_ += 1;
+}
+
+void ChecksumDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  disk_manager_->ReadPage(page_id, page_data);
+  num_verified_ += 1;
+  if (!VerifyChecksum(page_data)) {
+    num_corrupted_ += 1;
+    throw bustub::Exception("checksum mismatch on page " + std::to_string(page_id));
+  }
+  // The checksum is not page content, don't hand it to the caller
+  memset(page_data + Page::OFFSET_CHECKSUM, 0, sizeof(uint32_t));
+}
+
+void ChecksumDiskManager::WritePages(page_id_t page_id, const char *page_data, size_t num_pages) {
+  size_t size = num_pages * BUSTUB_PAGE_SIZE;
+  auto buffer = std::make_unique<char[]>(size);
+  memcpy(buffer.get(), page_data, size);
+  uint32_t checksum = ComputeChecksum(buffer.get(), size);
+  memcpy(buffer.get() + Page::OFFSET_CHECKSUM, &checksum, sizeof(checksum));
+  disk_manager_->WritePages(page_id, buffer.get(), num_pages);
+  num_writes_ += 1;
+}
+
+void ChecksumDiskManager::ReadPages(page_id_t page_id, char *page_data, size_t num_pages) {
+  disk_manager_->ReadPages(page_id, page_data, num_pages);
+  num_verified_ += 1;
+  if (!VerifyChecksum(page_data, num_pages * BUSTUB_PAGE_SIZE)) {
+    num_corrupted_ += 1;
+    throw bustub::Exception("checksum mismatch on page " + std::to_string(page_id));
+  }
+  // The checksum is not page content, don't hand it to the caller
+  memset(page_data + Page::OFFSET_CHECKSUM, 0, sizeof(uint32_t));
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+
+#include "disk_manager.h"
+
+/**
+ * ChecksumDiskManager adds page integrity checks on top of another DiskManager.
+ *
+ * On write, the CRC-32C of the page (excluding the checksum field itself) is stamped into the checksum field of
+ * the page header before the page is handed to the wrapped disk manager. On read, the checksum is recomputed and
+ * compared, so a torn or corrupted page is reported instead of being served silently. The checksum uses the
+ * hardware CRC instructions where available, which keeps the verification cost to a small fraction of a read.
+ *
+ * Pages that were never written read back as all zeroes with a zero checksum field, and are accepted as such.
+ * The checksum field is reserved, see Page::OFFSET_CHECKSUM: whatever the caller puts there is not stored, and it
+ * reads back as zeroes once the page is verified.
+ */
+class ChecksumDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new checksumming disk manager.
+   * @param disk_manager the disk manager that performs the actual I/O, must outlive this one
+   */
+  explicit ChecksumDiskManager(DiskManager *disk_manager) : disk_manager_(disk_manager) {}
+
+  /**
+   * Stamp the page checksum and write the page through the wrapped disk manager. The caller's buffer is
+   * left untouched.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Stamp the page checksum and write the modified ranges through the wrapped disk manager, together with the
+   * checksum field, which changes with every modification.
+   * @param page_id id of the page
+   * @param page_data raw page data, the whole page
+   * @param dirty_ranges the modified byte ranges
+   */
+  void WritePageDelta(page_id_t page_id, const char *page_data, const DirtyRangeSet &dirty_ranges) override;
+
+  /**
+   * Read a page through the wrapped disk manager, verify its checksum and clear the checksum field.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   * @throws bustub::Exception if the checksum does not match
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Stamp a single checksum over the whole of a multi-block page into its first block and write it through the
+   * wrapped disk manager. The other blocks carry payload in their first bytes, so they get no checksum field.
+   * @param page_id id of the first block
+   * @param page_data raw page data
+   * @param num_pages number of blocks
+   */
+  void WritePages(page_id_t page_id, const char *page_data, size_t num_pages) override;
+
+  /**
+   * Read a multi-block page through the wrapped disk manager, verify its checksum and clear the checksum field.
+   * @param page_id id of the first block
+   * @param[out] page_data output buffer
+   * @param num_pages number of blocks
+   * @throws bustub::Exception if the checksum does not match
+   */
+  void ReadPages(page_id_t page_id, char *page_data, size_t num_pages) override;
+
+  auto AllocatePage() -> page_id_t override { return disk_manager_->AllocatePage(); }
+
+  auto AllocatePages(size_t num_pages, page_id_t *page_id) -> bool override {
+    return disk_manager_->AllocatePages(num_pages, page_id);
+  }
+
+  void WriteSizeClass(page_id_t page_id, PageSizeClass size_class) override {
+    disk_manager_->WriteSizeClass(page_id, size_class);
+  }
+
+  auto ReadSizeClasses() -> std::vector<std::pair<page_id_t, PageSizeClass>> override {
+    return disk_manager_->ReadSizeClasses();
+  }
+
+  void DeallocatePage(page_id_t page_id) override { disk_manager_->DeallocatePage(page_id); }
+
+  void Sync() override { disk_manager_->Sync(); }
+
+  /** Log records carry no page checksum, they go straight to the wrapped disk manager. */
+  void WriteLog(char *log_data, int size) override { disk_manager_->WriteLog(log_data, size); }
+
+  void SyncLog() override { disk_manager_->SyncLog(); }
+
+  auto ReadLog(char *log_data, int size, int offset) -> bool override {
+    return disk_manager_->ReadLog(log_data, size, offset);
+  }
+
+  /** @return the number of pages whose checksum was verified */
+  auto GetNumVerified() const -> uint64_t { return num_verified_; }
+
+  /** @return the number of pages that failed verification */
+  auto GetNumCorrupted() const -> uint64_t { return num_corrupted_; }
+
+  /**
+   * @brief Compute the checksum of a page, skipping the checksum field.
+   * @param page_data page data
+   * @param size size of the page, a multiple of BUSTUB_PAGE_SIZE
+   * @return the page checksum
+   */
+  static auto ComputeChecksum(const char *page_data, size_t size = BUSTUB_PAGE_SIZE) -> uint32_t;
+
+  /**
+   * @brief Check the checksum stamped in a page.
+   * @param page_data page data
+   * @param size size of the page, a multiple of BUSTUB_PAGE_SIZE
+   * @return true if the page is intact (or was never written)
+   */
+  static auto VerifyChecksum(const char *page_data, size_t size = BUSTUB_PAGE_SIZE) -> bool;
+
+ private:
+  DiskManager *disk_manager_;
+  std::atomic<uint64_t> num_verified_{0};
+  std::atomic<uint64_t> num_corrupted_{0};
+};
@@ -0,0 +1,205 @@
+#include "compressed_disk_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "lz_codec.h"
+
+CompressedDiskManager::CompressedDiskManager(const std::string &db_file)
+    : map_name_(db_file + ".map"), free_extents_(SectorsFor(BUSTUB_PAGE_SIZE) + 1) {
+  file_name_ = db_file;
+  data_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  map_fd_ = open(map_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (data_fd_ < 0 || map_fd_ < 0) {
+    throw bustub::Exception("can't open compressed db file " + db_file);
+  }
+  log_name_ = db_file + ".log";
+  log_file_.Open(log_name_);
+  LoadExtentMap();
+}
+
+CompressedDiskManager::~CompressedDiskManager() { ShutDown(); }
+
+void CompressedDiskManager::ShutDown() {
+  std::scoped_lock scoped_lock(latch_);
+  if (data_fd_ >= 0) {
+    fsync(data_fd_);
+    close(data_fd_);
+    data_fd_ = -1;
+  }
+  if (map_fd_ >= 0) {
+    fsync(map_fd_);
+    close(map_fd_);
+    map_fd_ = -1;
+  }
+  log_file_.Close();
+}
+
+void CompressedDiskManager::LoadExtentMap() {
+  off_t map_size = lseek(map_fd_, 0, SEEK_END);
+  auto num_entries = static_cast<page_id_t>(map_size / static_cast<off_t>(sizeof(ExtentEntry)));
+  std::vector<ExtentEntry> entries(num_entries);
+  auto map_bytes = static_cast<ssize_t>(num_entries * sizeof(ExtentEntry));
+  if (pread(map_fd_, entries.data(), map_bytes, 0) != map_bytes) {
+    throw bustub::Exception("can't read extent map " + map_name_);
+  }
+
+  // Everything between live slots is free space, find it by walking the slots in file order
+  std::vector<std::pair<uint64_t, size_t>> used;
+  for (page_id_t page_id = 0; page_id < num_entries; ++page_id) {
+    if (entries[page_id].stored_size_ == 0) {
+      continue;
+    }
+    extents_[page_id] = entries[page_id];
+    used.emplace_back(entries[page_id].offset_, SectorsFor(entries[page_id].stored_size_));
+  }
+  std::sort(used.begin(), used.end());
+  uint64_t cursor = 0;
+  for (auto &[offset, sectors] : used) {
+    // Split gaps into the largest slots that fit
+    while (cursor < offset) {
+      size_t gap = std::min<uint64_t>((offset - cursor) / SECTOR_SIZE, free_extents_.size() - 1);
+      free_extents_[gap].push_back(cursor);
+      cursor += gap * SECTOR_SIZE;
+    }
+    cursor = offset + sectors * SECTOR_SIZE;
+  }
+  data_end_ = cursor;
+}
+
+auto CompressedDiskManager::AllocateExtent(size_t sectors) -> uint64_t {
+  if (!free_extents_[sectors].empty()) {
+    uint64_t offset = free_extents_[sectors].back();
+    free_extents_[sectors].pop_back();
+    return offset;
+  }
+  uint64_t offset = data_end_;
+  data_end_ += sectors * SECTOR_SIZE;
+  return offset;
+}
+
+void CompressedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  char buffer[LZCodec::MaxCompressedSize(BUSTUB_PAGE_SIZE)];
+  size_t size = LZCodec::Compress(page_data, BUSTUB_PAGE_SIZE, buffer, sizeof(buffer));
+  ExtentEntry entry{0, static_cast<uint32_t>(size), 0};
+  const char *stored = buffer;
+  if (size == 0 || SectorsFor(size) >= SectorsFor(BUSTUB_PAGE_SIZE)) {
+    // Doesn't save a single sector, keep it raw and skip decompression on read
+    entry.stored_size_ = BUSTUB_PAGE_SIZE;
+    entry.is_raw_ = 1;
+    stored = page_data;
+  }
+  size_t sectors = SectorsFor(entry.stored_size_);
+
+  std::scoped_lock scoped_lock(latch_);
+  auto it = extents_.find(page_id);
+  if (it != extents_.end() && SectorsFor(it->second.stored_size_) == sectors) {
+    // Same slot size, overwrite in place
+    entry.offset_ = it->second.offset_;
+  } else {
+    if (it != extents_.end()) {
+      // Until the new map record is synced, a crash leaves the map pointing at the old slot
+      pending_free_.emplace_back(SectorsFor(it->second.stored_size_), it->second.offset_);
+    }
+    entry.offset_ = AllocateExtent(sectors);
+  }
+
+  if (pwrite(data_fd_, stored, entry.stored_size_, static_cast<off_t>(entry.offset_)) !=
+          static_cast<ssize_t>(entry.stored_size_) ||
+      pwrite(map_fd_, &entry, sizeof(entry), static_cast<off_t>(page_id) * static_cast<off_t>(sizeof(entry))) !=
+          static_cast<ssize_t>(sizeof(entry))) {
+    throw bustub::Exception("I/O error while writing compressed page");
+  }
+  extents_[page_id] = entry;
+  num_writes_ += 1;
+  logical_bytes_written_ += BUSTUB_PAGE_SIZE;
+  physical_bytes_written_ += entry.stored_size_;
+}
+
+void CompressedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  char buffer[BUSTUB_PAGE_SIZE];
+  ExtentEntry entry;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    auto it = extents_.find(page_id);
+    if (it == extents_.end()) {
+      // Never written, same as reading past the end of an uncompressed file
+      memset(page_data, 0, BUSTUB_PAGE_SIZE);
+      return;
+    }
+    entry = it->second;
+    // Read under the latch, a concurrent write of this page may move it and recycle the slot
+    char *target = entry.is_raw_ != 0 ? page_data : buffer;
+    if (pread(data_fd_, target, entry.stored_size_, static_cast<off_t>(entry.offset_)) !=
+        static_cast<ssize_t>(entry.stored_size_)) {
+      throw bustub::Exception("I/O error while reading compressed page");
+    }
+    physical_bytes_read_ += entry.stored_size_;
+  }
+  if (entry.is_raw_ == 0 && !LZCodec::Decompress(buffer, entry.stored_size_, page_data, BUSTUB_PAGE_SIZE)) {
+    throw bustub::Exception("corrupted compressed page");
+  }
+}
+
+void CompressedDiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_lock(latch_);
+  auto it = extents_.find(page_id);
+  if (it == extents_.end()) {
+    return;
+  }
+  ExtentEntry entry{0, 0, 0};
+  if (pwrite(map_fd_, &entry, sizeof(entry), static_cast<off_t>(page_id) * static_cast<off_t>(sizeof(entry))) !=
+      static_cast<ssize_t>(sizeof(entry))) {
+    throw bustub::Exception("I/O error while writing extent map");
+  }
+  pending_free_.emplace_back(SectorsFor(it->second.stored_size_), it->second.offset_);
+  extents_.erase(it);
+}
+
+void CompressedDiskManager::WriteLog(char *log_data, int size) {
+  log_file_.Append(log_data, size);
+  std::scoped_lock scoped_lock(latch_);
+  num_flushes_ += 1;
+}
+
+void CompressedDiskManager::Sync() {
+  // Only slots whose map records were written before the sync can be reused after it
+  std::vector<std::pair<size_t, uint64_t>> released;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    released.swap(pending_free_);
+  }
+  if (fdatasync(data_fd_) != 0 || fdatasync(map_fd_) != 0) {
+    std::scoped_lock scoped_lock(latch_);
+    pending_free_.insert(pending_free_.end(), released.begin(), released.end());
+    throw bustub::Exception("I/O error while syncing data file");
+  }
+  std::scoped_lock scoped_lock(latch_);
+  for (auto &[sectors, offset] : released) {
+    free_extents_[sectors].push_back(offset);
+  }
+}
+
+auto CompressedDiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
+  return log_file_.Read(log_data, size, offset);
+}
+
+auto CompressedDiskManager::GetCompressionRatio() -> double {
+  std::scoped_lock scoped_lock(latch_);
+  if (physical_bytes_written_ == 0) {
+    return 0;
+  }
+  return static_cast<double>(logical_bytes_written_) / static_cast<double>(physical_bytes_written_);
+}
+
+auto CompressedDiskManager::GetPhysicalBytesWritten() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return physical_bytes_written_;
+}
+
+auto CompressedDiskManager::GetPhysicalBytesRead() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return physical_bytes_read_;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "disk_manager.h"
+#include "log_file.h"
+
+/**
+ * CompressedDiskManager is a storage backend that keeps pages compressed on disk.
+ *
+ * Every page is compressed with LZCodec on write and stored in a variable-size slot made of SECTOR_SIZE-byte
+ * sectors, so a page that compresses well costs fewer bytes on every read and write. Pages that don't save at
+ * least one sector are stored raw. The page id -> extent map lives in a separate `.map` file next to the data
+ * file, one fixed-size record per page id, and is loaded back when the database is reopened.
+ *
+ * Freed extents are recycled through one free list per slot size (in sectors). Extents are not coalesced;
+ * since there are only BUSTUB_PAGE_SIZE / SECTOR_SIZE slot sizes, fragmentation stays bounded. A slot given up
+ * by a rewrite or a deallocation is only reused after the next Sync, once the map no longer refers to it even
+ * after a crash; until then new slots come from the end of the file.
+ */
+class CompressedDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new compressed disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to, the extent map goes to `<db_file>.map` and the
+   * log to `<db_file>.log`
+   */
+  explicit CompressedDiskManager(const std::string &db_file);
+
+  ~CompressedDiskManager() override;
+
+  /**
+   * Shut down the disk manager and close all the file resources.
+   */
+  void ShutDown();
+
+  /**
+   * Compress a page and write it to a slot of the database file, then record its extent in the map.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Read a page and decompress it. Pages that were never written read as zeroes.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Append to the log file `<db_file>.log` and make it durable. Log data is not compressed.
+   * @param log_data raw log data
+   * @param size size of log entry
+   */
+  void WriteLog(char *log_data, int size) override;
+
+  /** WriteLog is durable already. */
+  void SyncLog() override {}
+
+  /**
+   * Clear the extent map record of a page, its slot is reused after the next Sync.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id) override;
+
+  /**
+   * Make the data file and the extent map durable, and release the slots given up since the last Sync.
+   */
+  void Sync() override;
+
+  /**
+   * Read a log entry from the log file.
+   * @param[out] log_data output buffer
+   * @param size size of the log entry
+   * @param offset offset of the log entry in the file
+   * @return true if the read was successful, false otherwise
+   */
+  auto ReadLog(char *log_data, int size, int offset) -> bool override;
+
+  /** @return logical bytes written divided by physical bytes written, 0 if nothing was written */
+  auto GetCompressionRatio() -> double;
+
+  /** @return the number of bytes of page data written to the data file */
+  auto GetPhysicalBytesWritten() -> uint64_t;
+
+  /** @return the number of bytes of page data read from the data file */
+  auto GetPhysicalBytesRead() -> uint64_t;
+
+  /** Allocation unit of the data file. */
+  static constexpr size_t SECTOR_SIZE = 512;
+
+ private:
+  /** On-disk record of the extent map, one per page id. */
+  struct ExtentEntry {
+    /** Byte offset of the slot in the data file. */
+    uint64_t offset_;
+    /** Number of bytes stored in the slot, 0 if the page was never written. */
+    uint32_t stored_size_;
+    /** True if the slot holds the raw page rather than compressed data. */
+    uint32_t is_raw_;
+  };
+
+  static constexpr auto SectorsFor(size_t bytes) -> size_t { return (bytes + SECTOR_SIZE - 1) / SECTOR_SIZE; }
+
+  /** @brief Rebuild the in-memory extent map and free lists from the map file. */
+  void LoadExtentMap();
+
+  /** @brief Find a slot of the given number of sectors. Caller should hold the latch. */
+  auto AllocateExtent(size_t sectors) -> uint64_t;
+
+  int data_fd_{-1};
+  int map_fd_{-1};
+  LogFile log_file_;
+  std::string map_name_;
+  std::unordered_map<page_id_t, ExtentEntry> extents_;
+  /** free_extents_[n] holds offsets of free slots that are n sectors long. */
+  std::vector<std::vector<uint64_t>> free_extents_;
+  /** Slots given up since the last Sync, as {sectors, offset}. */
+  std::vector<std::pair<size_t, uint64_t>> pending_free_;
+  /** End of the data file, where new slots are appended. */
+  uint64_t data_end_{0};
+  uint64_t logical_bytes_written_{0};
+  uint64_t physical_bytes_written_{0};
+  uint64_t physical_bytes_read_{0};
+  /** Protects the extent map, the free lists and the counters. */
+  std::mutex latch_;
+};
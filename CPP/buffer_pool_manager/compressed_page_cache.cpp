@@ -0,0 +1,186 @@
+#include "compressed_page_cache.h"
+
+#include <tuple>
+
+#include "lz_codec.h"
+
+CompressedPageCache::CompressedPageCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+void CompressedPageCache::Insert(page_id_t page_id, const char *page_data) {
+  // Compress outside the latch, it's the expensive part
+  char buffer[MAX_STORED_SIZE];
+  size_t size = LZCodec::Compress(page_data, BUSTUB_PAGE_SIZE, buffer, MAX_STORED_SIZE);
+  if (size == 0 || size > budget_bytes_) {
+    // Not compressible enough, a disk read is cheaper than the memory it would take
+    std::scoped_lock scoped_lock(latch_);
+    auto it = entries_.find(page_id);
+    if (it != entries_.end()) {
+      EraseUnlocked(it);
+    }
+    return;
+  }
+
+  Entry entry;
+  entry.data_ = std::make_unique<char[]>(size);
+  memcpy(entry.data_.get(), buffer, size);
+  entry.size_ = size;
+
+  std::scoped_lock scoped_lock(latch_);
+  StoreUnlocked(page_id, std::move(entry));
+}
+
+void CompressedPageCache::InsertDeferred(page_id_t page_id, const char *page_data) {
+  if (BUSTUB_PAGE_SIZE > budget_bytes_) {
+    // The uncompressed copy alone would exceed the budget
+    Erase(page_id);
+    return;
+  }
+  Entry entry;
+  entry.data_ = std::make_unique<char[]>(BUSTUB_PAGE_SIZE);
+  memcpy(entry.data_.get(), page_data, BUSTUB_PAGE_SIZE);
+  entry.size_ = BUSTUB_PAGE_SIZE;
+  entry.deferred_ = true;
+
+  std::scoped_lock scoped_lock(latch_);
+  auto it = entries_.find(page_id);
+  if (it != entries_.end()) {
+    EraseUnlocked(it);
+  }
+  // Charged at full size until CompressDeferred replaces it, which releases the difference
+  MakeRoomUnlocked(entry.size_);
+  used_bytes_ += entry.size_;
+  entry.version_ = next_version_++;
+  deferred_.emplace_back(page_id, entry.version_);
+  lru_list_.push_back(page_id);
+  entry.lru_pos_ = std::prev(lru_list_.end());
+  entries_.emplace(page_id, std::move(entry));
+}
+
+void CompressedPageCache::CompressDeferred() {
+  char page_data[BUSTUB_PAGE_SIZE];
+  char buffer[MAX_STORED_SIZE];
+  while (true) {
+    page_id_t page_id;
+    uint64_t version;
+    {
+      std::scoped_lock scoped_lock(latch_);
+      auto it = entries_.end();
+      while (it == entries_.end() && !deferred_.empty()) {
+        std::tie(page_id, version) = deferred_.front();
+        deferred_.pop_front();
+        it = entries_.find(page_id);
+        if (it != entries_.end() && (!it->second.deferred_ || it->second.version_ != version)) {
+          it = entries_.end();
+        }
+      }
+      if (it == entries_.end()) {
+        return;
+      }
+      // The entry may be looked up while we compress, so work on a copy
+      memcpy(page_data, it->second.data_.get(), BUSTUB_PAGE_SIZE);
+    }
+
+    size_t size = LZCodec::Compress(page_data, BUSTUB_PAGE_SIZE, buffer, MAX_STORED_SIZE);
+    std::scoped_lock scoped_lock(latch_);
+    auto it = entries_.find(page_id);
+    if (it == entries_.end() || !it->second.deferred_ || it->second.version_ != version) {
+      continue;
+    }
+    if (size == 0 || size > budget_bytes_) {
+      EraseUnlocked(it);
+      continue;
+    }
+    Entry entry;
+    entry.data_ = std::make_unique<char[]>(size);
+    memcpy(entry.data_.get(), buffer, size);
+    entry.size_ = size;
+    StoreUnlocked(page_id, std::move(entry));
+  }
+}
+
+void CompressedPageCache::StoreUnlocked(page_id_t page_id, Entry entry) {
+  auto it = entries_.find(page_id);
+  if (it != entries_.end()) {
+    EraseUnlocked(it);
+  }
+  MakeRoomUnlocked(entry.size_);
+  lru_list_.push_back(page_id);
+  entry.lru_pos_ = std::prev(lru_list_.end());
+  used_bytes_ += entry.size_;
+  stored_raw_bytes_ += BUSTUB_PAGE_SIZE;
+  stored_compressed_bytes_ += entry.size_;
+  entries_.emplace(page_id, std::move(entry));
+}
+
+auto CompressedPageCache::Lookup(page_id_t page_id, char *page_data) -> bool {
+  std::unique_ptr<char[]> data;
+  size_t size;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    auto it = entries_.find(page_id);
+    if (it == entries_.end()) {
+      miss_count_ += 1;
+      return false;
+    }
+    hit_count_ += 1;
+    if (it->second.deferred_) {
+      memcpy(page_data, it->second.data_.get(), BUSTUB_PAGE_SIZE);
+      EraseUnlocked(it);
+      return true;
+    }
+    data = std::move(it->second.data_);
+    size = it->second.size_;
+    EraseUnlocked(it);
+  }
+  // Only we can see the buffer now, so decompress without the latch
+  return LZCodec::Decompress(data.get(), size, page_data, BUSTUB_PAGE_SIZE);
+}
+
+void CompressedPageCache::Erase(page_id_t page_id) {
+  std::scoped_lock scoped_lock(latch_);
+  auto it = entries_.find(page_id);
+  if (it != entries_.end()) {
+    EraseUnlocked(it);
+  }
+}
+
+void CompressedPageCache::MakeRoomUnlocked(size_t size) {
+  // Oldest pages go first
+  while (used_bytes_ + size > budget_bytes_) {
+    EraseUnlocked(entries_.find(lru_list_.front()));
+  }
+}
+
+void CompressedPageCache::EraseUnlocked(std::unordered_map<page_id_t, Entry>::iterator it) {
+  used_bytes_ -= it->second.size_;
+  lru_list_.erase(it->second.lru_pos_);
+  entries_.erase(it);
+}
+
+auto CompressedPageCache::Size() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return entries_.size();
+}
+
+auto CompressedPageCache::GetUsedBytes() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return used_bytes_;
+}
+
+auto CompressedPageCache::GetHitCount() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return hit_count_;
+}
+
+auto CompressedPageCache::GetMissCount() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return miss_count_;
+}
+
+auto CompressedPageCache::GetCompressionRatio() -> double {
+  std::scoped_lock scoped_lock(latch_);
+  if (stored_compressed_bytes_ == 0) {
+    return 0;
+  }
+  return static_cast<double>(stored_raw_bytes_) / static_cast<double>(stored_compressed_bytes_);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+
+/**
+ * CompressedPageCache is an optional second-level cache that sits between the buffer pool and the disk.
+ *
+ * Pages evicted from the buffer pool are stored LZ-compressed in a bounded memory budget and are handed back on a
+ * later miss, which saves the disk read. The cache is exclusive: a page is removed from it when it is looked up,
+ * since it then lives in the buffer pool again, so the cache can never hold a stale copy of a pool page.
+ * When the budget is exceeded, the least recently inserted pages are dropped.
+ *
+ * A caller that evicts under its own latch stores pages with InsertDeferred, which only copies them, and compresses
+ * them later with CompressDeferred once the latch is released.
+ */
+class CompressedPageCache {
+ public:
+  /**
+   * @brief Creates a new CompressedPageCache.
+   * @param budget_bytes maximum number of bytes of page data to hold, compressed or not
+   */
+  explicit CompressedPageCache(size_t budget_bytes);
+
+  DISALLOW_COPY_AND_MOVE(CompressedPageCache);
+
+  ~CompressedPageCache() = default;
+
+  /**
+   * @brief Store a clean copy of a page that is leaving the buffer pool. Pages that don't compress well
+   * enough to be worth the memory are not stored.
+   * @param page_id id of the page
+   * @param page_data BUSTUB_PAGE_SIZE bytes of page content, identical to what is on disk
+   */
+  void Insert(page_id_t page_id, const char *page_data);
+
+  /**
+   * @brief Store an uncompressed copy of a page, to be compressed by the next CompressDeferred. Until then the copy
+   * is found by Lookup like any other page, and charged to the budget at its full size, so older pages may be
+   * dropped to make room for it.
+   * @param page_id id of the page
+   * @param page_data BUSTUB_PAGE_SIZE bytes of page content, identical to what is on disk
+   */
+  void InsertDeferred(page_id_t page_id, const char *page_data);
+
+  /**
+   * @brief Compress the pages stored by InsertDeferred, whichever thread stored them. Pages that are looked up or
+   * replaced meanwhile are skipped.
+   */
+  void CompressDeferred();
+
+  /**
+   * @brief Take a page out of the cache.
+   * @param page_id id of the page
+   * @param[out] page_data BUSTUB_PAGE_SIZE bytes output buffer
+   * @return true if the page was found, in which case it is no longer in the cache
+   */
+  auto Lookup(page_id_t page_id, char *page_data) -> bool;
+
+  /**
+   * @brief Drop a page from the cache, e.g. because it was deleted.
+   * @param page_id id of the page
+   */
+  void Erase(page_id_t page_id);
+
+  /** @return the number of pages currently cached */
+  auto Size() -> size_t;
+
+  /** @return the number of bytes of page data currently held, compressed or waiting for CompressDeferred */
+  auto GetUsedBytes() -> size_t;
+
+  /** @return the number of successful lookups */
+  auto GetHitCount() -> size_t;
+
+  /** @return the number of lookups that found nothing */
+  auto GetMissCount() -> size_t;
+
+  /** @return uncompressed bytes divided by compressed bytes over all stored pages, 0 if nothing was stored */
+  auto GetCompressionRatio() -> double;
+
+  /** Pages that compress to more than this many bytes are not cached. */
+  static constexpr size_t MAX_STORED_SIZE = BUSTUB_PAGE_SIZE * 3 / 4;
+
+ private:
+  struct Entry {
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+    /** True if data_ is the uncompressed page, waiting for CompressDeferred. */
+    bool deferred_{false};
+    /** Tells a deferred entry from a later one of the same page. */
+    uint64_t version_{0};
+    /** Position in lru_list_. */
+    std::list<page_id_t>::iterator lru_pos_;
+  };
+
+  /** @brief Store a compressed page, replacing any entry of the page. Caller should hold the latch. */
+  void StoreUnlocked(page_id_t page_id, Entry entry);
+
+  /** @brief Drop the least recently inserted pages until `size` more bytes fit. Caller should hold the latch. */
+  void MakeRoomUnlocked(size_t size);
+
+  /** @brief Drop an entry. Caller should hold the latch. */
+  void EraseUnlocked(std::unordered_map<page_id_t, Entry>::iterator it);
+
+  const size_t budget_bytes_;
+  size_t used_bytes_{0};
+  std::unordered_map<page_id_t, Entry> entries_;
+  /** Cached page ids, least recently inserted first. */
+  std::list<page_id_t> lru_list_;
+  /** Deferred entries to compress, with their version. */
+  std::deque<std::pair<page_id_t, uint64_t>> deferred_;
+  uint64_t next_version_{0};
+  size_t hit_count_{0};
+  size_t miss_count_{0};
+  size_t stored_raw_bytes_{0};
+  size_t stored_compressed_bytes_{0};
+  std::mutex latch_;
+};
@@ -0,0 +1,60 @@
+#include "count_min_sketch.h"
+
+#include <algorithm>
+
+namespace {
+
+/** Per-row seeds, any odd 64-bit constants will do. */
+constexpr uint64_t ROW_SEEDS[] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+                                  0xD6E8FEB86659FD93ULL};
+
+}  // namespace
+
+CountMinSketch::CountMinSketch(size_t capacity) {
+  // Round the width up to a power of two so that a mask can replace the modulo
+  width_ = 16;
+  while (width_ < capacity) {
+    width_ <<= 1;
+  }
+  table_.resize(DEPTH * width_ / 2, 0);
+  // Same ratio as the original W-TinyLFU paper: age after ten accesses per tracked item
+  sample_size_ = 10 * std::max<size_t>(capacity, 1);
+}
+
+auto CountMinSketch::IndexOf(page_id_t page_id, size_t row) const -> size_t {
+  // splitmix64 finalizer, seeded per row so that rows collide independently
+  uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(page_id)) + ROW_SEEDS[row];
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+  hash ^= hash >> 31;
+  return row * width_ + (hash & (width_ - 1));
+}
+
+void CountMinSketch::Increment(page_id_t page_id) {
+  for (size_t row = 0; row < DEPTH; ++row) {
+    size_t index = IndexOf(page_id, row);
+    if (CounterAt(index) < MAX_COUNT) {
+      table_[index >> 1] += 1 << Shift(index);
+    }
+  }
+  if (++additions_ >= sample_size_) {
+    Age();
+  }
+}
+
+auto CountMinSketch::Estimate(page_id_t page_id) const -> uint8_t {
+  uint8_t estimate = MAX_COUNT;
+  for (size_t row = 0; row < DEPTH; ++row) {
+    estimate = std::min(estimate, CounterAt(IndexOf(page_id, row)));
+  }
+  return estimate;
+}
+
+void CountMinSketch::Age() {
+  for (auto &pair : table_) {
+    // Halve both nibbles at once, dropping the bit the high one would shift into the low one
+    pair = (pair >> 1) & 0x77;
+  }
+  additions_ /= 2;
+  aging_count_ += 1;
+}
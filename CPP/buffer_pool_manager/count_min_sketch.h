@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * CountMinSketch is a compact, approximate frequency counter for page ids, used by the buffer pool's
+ * TinyLFU admission filter.
+ *
+ * Every page id is hashed into one 4-bit counter per row, two to a byte, and its frequency is estimated as the
+ * minimum over the rows, so estimates can only be too high, never too low. To keep the history recent, all counters
+ * are halved once the number of recorded accesses reaches the sample size (aging), which lets pages that used to
+ * be hot cool down again.
+ */
+class CountMinSketch {
+ public:
+  /**
+   * @brief Creates a new CountMinSketch.
+   * @param capacity the number of items the sketch should track with reasonable accuracy, usually the pool size
+   */
+  explicit CountMinSketch(size_t capacity);
+
+  /**
+   * @brief Record one access to the given page. Counters saturate at MAX_COUNT.
+   * @param page_id id of the accessed page
+   */
+  void Increment(page_id_t page_id);
+
+  /**
+   * @brief Estimate how often the given page was accessed recently.
+   * @param page_id id of the page
+   * @return the estimated access count, in [0, MAX_COUNT]
+   */
+  auto Estimate(page_id_t page_id) const -> uint8_t;
+
+  /** @return the number of times the counters have been halved so far */
+  auto GetAgingCount() const -> size_t { return aging_count_; }
+
+  /** Largest value a single counter can hold. */
+  static constexpr uint8_t MAX_COUNT = 15;
+
+ private:
+  /** Number of independent hash rows. */
+  static constexpr size_t DEPTH = 4;
+
+  /** @brief Index of the counter of the given page in the given row, counting counters rather than bytes. */
+  auto IndexOf(page_id_t page_id, size_t row) const -> size_t;
+
+  /** @return the counter at the given index */
+  auto CounterAt(size_t index) const -> uint8_t { return (table_[index >> 1] >> Shift(index)) & MAX_COUNT; }
+
+  /** @return the position of the counter at the given index within its byte */
+  static auto Shift(size_t index) -> int { return static_cast<int>(index & 1) * 4; }
+
+  /** @brief Halve every counter, and the number of recorded accesses along with them. */
+  void Age();
+
+  /** DEPTH rows of `width_` counters each, stored row after row, the even counter of each pair in the low nibble. */
+  std::vector<uint8_t> table_;
+  /** Number of counters per row, always a power of two. */
+  size_t width_;
+  /** Number of accesses after which the counters are aged. */
+  size_t sample_size_;
+  /** Number of accesses recorded since the last aging. */
+  size_t additions_{0};
+  size_t aging_count_{0};
+};
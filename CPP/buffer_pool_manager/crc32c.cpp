@@ -0,0 +1,192 @@
+#include "crc32c.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+/** Reflected Castagnoli polynomial. */
+constexpr uint32_t POLY = 0x82F63B78;
+
+using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+auto BuildTables() -> Tables {
+  Tables tables{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? POLY : 0);
+    }
+    tables[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (size_t t = 1; t < 8; ++t) {
+      tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+    }
+  }
+  return tables;
+}
+
+auto ExtendPortable(uint32_t crc, const char *data, size_t size) -> uint32_t {
+  static const Tables TABLES = BuildTables();
+  const auto *p = reinterpret_cast<const uint8_t *>(data);
+  // Slicing-by-8: fold eight bytes per step through eight tables
+  while (size >= 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    word ^= crc;
+    crc = TABLES[7][word & 0xFF] ^ TABLES[6][(word >> 8) & 0xFF] ^ TABLES[5][(word >> 16) & 0xFF] ^
+          TABLES[4][(word >> 24) & 0xFF] ^ TABLES[3][(word >> 32) & 0xFF] ^ TABLES[2][(word >> 40) & 0xFF] ^
+          TABLES[1][(word >> 48) & 0xFF] ^ TABLES[0][word >> 56];
+    p += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = (crc >> 8) ^ TABLES[0][(crc ^ *p++) & 0xFF];
+  }
+  return crc;
+}
+
+/**
+ * Advances a CRC register over `length` zero bytes in four table lookups. Used to merge the independent streams of
+ * the interleaved hardware loop: crc(A || B) = Shift(crc(A)) ^ crc_from_zero(B) when B is `length` bytes long.
+ */
+class ZeroShifter {
+ public:
+  explicit ZeroShifter(size_t length) {
+    std::array<char, 4096> zeros{};
+    for (uint32_t byte = 0; byte < 256; ++byte) {
+      for (size_t k = 0; k < 4; ++k) {
+        uint32_t crc = byte << (8 * k);
+        size_t remaining = length;
+        while (remaining > 0) {
+          size_t step = std::min(remaining, zeros.size());
+          crc = ExtendPortable(crc, zeros.data(), step);
+          remaining -= step;
+        }
+        tables_[k][byte] = crc;
+      }
+    }
+  }
+
+  auto Shift(uint32_t crc) const -> uint32_t {
+    return tables_[0][crc & 0xFF] ^ tables_[1][(crc >> 8) & 0xFF] ^ tables_[2][(crc >> 16) & 0xFF] ^
+           tables_[3][crc >> 24];
+  }
+
+ private:
+  std::array<std::array<uint32_t, 256>, 4> tables_;
+};
+
+/**
+ * Length of each of the three interleaved streams. The crc instruction has a latency of three cycles but can
+ * start every cycle, so three independent streams keep it busy. 3 * 1360 bytes covers a whole 4 KiB page.
+ */
+constexpr size_t STREAM_LENGTH = 1360;
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2"))) auto ExtendHardware(uint32_t crc, const char *data, size_t size) -> uint32_t {
+  static const ZeroShifter SHIFTER(STREAM_LENGTH);
+  uint64_t crc0 = crc;
+  while (size >= 3 * STREAM_LENGTH) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (size_t i = 0; i < STREAM_LENGTH; i += 8) {
+      uint64_t word0;
+      uint64_t word1;
+      uint64_t word2;
+      memcpy(&word0, data + i, sizeof(word0));
+      memcpy(&word1, data + STREAM_LENGTH + i, sizeof(word1));
+      memcpy(&word2, data + 2 * STREAM_LENGTH + i, sizeof(word2));
+      crc0 = _mm_crc32_u64(crc0, word0);
+      crc1 = _mm_crc32_u64(crc1, word1);
+      crc2 = _mm_crc32_u64(crc2, word2);
+    }
+    crc0 = SHIFTER.Shift(SHIFTER.Shift(static_cast<uint32_t>(crc0)) ^ static_cast<uint32_t>(crc1)) ^
+           static_cast<uint32_t>(crc2);
+    data += 3 * STREAM_LENGTH;
+    size -= 3 * STREAM_LENGTH;
+  }
+  while (size >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc0 = _mm_crc32_u64(crc0, word);
+    data += 8;
+    size -= 8;
+  }
+  auto crc32 = static_cast<uint32_t>(crc0);
+  while (size-- > 0) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data++));
+  }
+  return crc32;
+}
+
+auto HasHardware() -> bool {
+  static const bool HAS_SSE42 = __builtin_cpu_supports("sse4.2");
+  return HAS_SSE42;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+auto ExtendHardware(uint32_t crc, const char *data, size_t size) -> uint32_t {
+  static const ZeroShifter SHIFTER(STREAM_LENGTH);
+  while (size >= 3 * STREAM_LENGTH) {
+    uint32_t crc1 = 0;
+    uint32_t crc2 = 0;
+    for (size_t i = 0; i < STREAM_LENGTH; i += 8) {
+      uint64_t word0;
+      uint64_t word1;
+      uint64_t word2;
+      memcpy(&word0, data + i, sizeof(word0));
+      memcpy(&word1, data + STREAM_LENGTH + i, sizeof(word1));
+      memcpy(&word2, data + 2 * STREAM_LENGTH + i, sizeof(word2));
+      crc = __crc32cd(crc, word0);
+      crc1 = __crc32cd(crc1, word1);
+      crc2 = __crc32cd(crc2, word2);
+    }
+    crc = SHIFTER.Shift(SHIFTER.Shift(crc) ^ crc1) ^ crc2;
+    data += 3 * STREAM_LENGTH;
+    size -= 3 * STREAM_LENGTH;
+  }
+  while (size >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+    data += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = __crc32cb(crc, static_cast<uint8_t>(*data++));
+  }
+  return crc;
+}
+
+constexpr auto HasHardware() -> bool { return true; }
+
+#else
+
+auto ExtendHardware(uint32_t crc, const char *data, size_t size) -> uint32_t {
+  return ExtendPortable(crc, data, size);
+}
+
+constexpr auto HasHardware() -> bool { return false; }
+
+#endif
+
+}  // namespace
+
+auto Crc32c::Extend(uint32_t crc, const char *data, size_t size) -> uint32_t {
+  crc = ~crc;
+  crc = HasHardware() ? ExtendHardware(crc, data, size) : ExtendPortable(crc, data, size);
+  return ~crc;
+}
+
+auto Crc32c::IsHardwareAccelerated() -> bool { return HasHardware(); }
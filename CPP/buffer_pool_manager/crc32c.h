@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC-32C (Castagnoli) checksums, as used for page integrity checks.
+ *
+ * Uses the SSE4.2 crc32 instruction on x86-64 when the CPU supports it (detected at runtime), the ARMv8 CRC
+ * extension when the target is compiled with it, and a portable slicing-by-8 table implementation otherwise.
+ * All implementations produce the same values.
+ */
+class Crc32c {
+ public:
+  /**
+   * @brief Compute the CRC-32C of a buffer.
+   * @param data input data
+   * @param size number of bytes
+   * @return the checksum
+   */
+  static auto Compute(const char *data, size_t size) -> uint32_t { return Extend(0, data, size); }
+
+  /**
+   * @brief Continue a CRC-32C computation with more data.
+   * @param crc checksum of the data so far
+   * @param data input data
+   * @param size number of bytes
+   * @return the checksum of the concatenated data
+   */
+  static auto Extend(uint32_t crc, const char *data, size_t size) -> uint32_t;
+
+  /** @return true if a hardware CRC instruction is used */
+  static auto IsHardwareAccelerated() -> bool;
+};
@@ -0,0 +1,350 @@
+#include "delta_disk_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "crc32c.h"
+
+DeltaDiskManager::DeltaDiskManager(DiskManager *disk_manager, const std::string &delta_file, size_t max_delta_bytes,
+                                   uint64_t max_log_size)
+    : disk_manager_(disk_manager),
+      delta_name_(delta_file),
+      max_delta_bytes_(max_delta_bytes),
+      max_log_size_(max_log_size) {
+  delta_fd_ = open(delta_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (delta_fd_ < 0) {
+    throw bustub::Exception("can't open delta log " + delta_name_);
+  }
+  Recover();
+}
+
+DeltaDiskManager::~DeltaDiskManager() {
+  StopConsolidationThread();
+  if (delta_fd_ >= 0) {
+    fsync(delta_fd_);
+    close(delta_fd_);
+    delta_fd_ = -1;
+  }
+}
+
+void DeltaDiskManager::Recover() {
+  alignas(RecordHeader) char record[MAX_RECORD_SIZE];
+  const auto *header = reinterpret_cast<const RecordHeader *>(record);
+  uint64_t offset = 0;
+  while (true) {
+    if (pread(delta_fd_, record, sizeof(RecordHeader), static_cast<off_t>(offset)) !=
+        static_cast<ssize_t>(sizeof(RecordHeader))) {
+      break;
+    }
+    if (header->num_ranges_ > DirtyRangeSet::MAX_RANGES ||
+        header->payload_size_ > MAX_RECORD_SIZE - sizeof(RecordHeader)) {
+      break;
+    }
+    if (pread(delta_fd_, record + sizeof(RecordHeader), header->payload_size_,
+              static_cast<off_t>(offset + sizeof(RecordHeader))) != static_cast<ssize_t>(header->payload_size_)) {
+      break;
+    }
+    if (Crc32c::Compute(record + sizeof(uint32_t), sizeof(RecordHeader) - sizeof(uint32_t) + header->payload_size_) !=
+        header->checksum_) {
+      break;
+    }
+    LinkRecord(record, offset);
+    offset += sizeof(RecordHeader) + header->payload_size_;
+  }
+  // Whatever follows the last intact record was torn by a crash
+  if (ftruncate(delta_fd_, static_cast<off_t>(offset)) != 0) {
+    throw bustub::Exception("can't truncate delta log " + delta_name_);
+  }
+  log_end_ = offset;
+}
+
+void DeltaDiskManager::LinkRecord(const char *record, uint64_t offset) {
+  const auto *header = reinterpret_cast<const RecordHeader *>(record);
+  const auto *ranges = reinterpret_cast<const DirtyRangeSet::Range *>(record + sizeof(RecordHeader));
+  if (header->num_ranges_ == 0) {
+    chains_.erase(header->page_id_);
+    return;
+  }
+  bool is_full = header->num_ranges_ == 1 && ranges[0].begin_ == 0 && ranges[0].end_ == BUSTUB_PAGE_SIZE;
+  auto &chain = chains_[header->page_id_];
+  if (is_full) {
+    // Nothing before a full image matters any more
+    chain.clear();
+  }
+  chain.push_back({offset, static_cast<uint32_t>(sizeof(RecordHeader) + header->payload_size_), is_full});
+}
+
+void DeltaDiskManager::ApplyRecord(const char *record, char *page_data) {
+  const auto *header = reinterpret_cast<const RecordHeader *>(record);
+  const auto *ranges = reinterpret_cast<const DirtyRangeSet::Range *>(record + sizeof(RecordHeader));
+  const char *bytes = record + sizeof(RecordHeader) + header->num_ranges_ * sizeof(DirtyRangeSet::Range);
+  for (uint32_t i = 0; i < header->num_ranges_; ++i) {
+    memcpy(page_data + ranges[i].begin_, bytes, ranges[i].end_ - ranges[i].begin_);
+    bytes += ranges[i].end_ - ranges[i].begin_;
+  }
+}
+
+void DeltaDiskManager::AppendRecord(page_id_t page_id, const char *page_data, const DirtyRangeSet &dirty_ranges) {
+  alignas(RecordHeader) char record[MAX_RECORD_SIZE];
+  auto *header = reinterpret_cast<RecordHeader *>(record);
+  auto *ranges = reinterpret_cast<DirtyRangeSet::Range *>(record + sizeof(RecordHeader));
+  uint32_t num_ranges = 0;
+  if (dirty_ranges.IsAll()) {
+    ranges[num_ranges++] = {0, static_cast<uint32_t>(BUSTUB_PAGE_SIZE)};
+  } else {
+    for (const auto &range : dirty_ranges) {
+      ranges[num_ranges++] = range;
+    }
+  }
+  char *bytes = record + sizeof(RecordHeader) + num_ranges * sizeof(DirtyRangeSet::Range);
+  for (uint32_t i = 0; i < num_ranges; ++i) {
+    memcpy(bytes, page_data + ranges[i].begin_, ranges[i].end_ - ranges[i].begin_);
+    bytes += ranges[i].end_ - ranges[i].begin_;
+  }
+  auto size = static_cast<size_t>(bytes - record);
+  header->page_id_ = page_id;
+  header->num_ranges_ = num_ranges;
+  header->payload_size_ = static_cast<uint32_t>(size - sizeof(RecordHeader));
+  header->checksum_ = Crc32c::Compute(record + sizeof(uint32_t), size - sizeof(uint32_t));
+
+  if (pwrite(delta_fd_, record, size, static_cast<off_t>(log_end_)) != static_cast<ssize_t>(size)) {
+    throw bustub::Exception("I/O error while writing delta log");
+  }
+  LinkRecord(record, log_end_);
+  log_end_ += size;
+  delta_bytes_written_ += size;
+}
+
+void DeltaDiskManager::FoldPage(page_id_t page_id, const std::vector<DeltaRef> &chain, char *page_data) {
+  if (!chain.front().is_full_) {
+    disk_manager_->ReadPage(page_id, page_data);
+  }
+  alignas(RecordHeader) char record[MAX_RECORD_SIZE];
+  for (const auto &ref : chain) {
+    if (pread(delta_fd_, record, ref.size_, static_cast<off_t>(ref.offset_)) != static_cast<ssize_t>(ref.size_)) {
+      throw bustub::Exception("I/O error while reading delta log");
+    }
+    ApplyRecord(record, page_data);
+  }
+}
+
+void DeltaDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  std::scoped_lock scoped_lock(latch_);
+  num_full_writes_ += 1;
+  if (chains_.count(page_id) != 0) {
+    // Writing the base page directly would let the older deltas overwrite it when the page is read
+    DirtyRangeSet whole_page;
+    whole_page.MarkAll();
+    AppendRecord(page_id, page_data, whole_page);
+    MaybeConsolidate();
+    return;
+  }
+  disk_manager_->WritePage(page_id, page_data);
+  unsynced_base_pages_.insert(page_id);
+}
+
+void DeltaDiskManager::WritePageDelta(page_id_t page_id, const char *page_data, const DirtyRangeSet &dirty_ranges) {
+  if (dirty_ranges.IsAll() || dirty_ranges.IsEmpty() || dirty_ranges.Bytes() > max_delta_bytes_) {
+    WritePage(page_id, page_data);
+    return;
+  }
+  std::scoped_lock scoped_lock(latch_);
+  if (chains_.count(page_id) == 0 && unsynced_base_pages_.count(page_id) != 0) {
+    // A delta against a base page that may not be on disk yet could be replayed onto an older one after a
+    // crash, a full image doesn't depend on the base page
+    DirtyRangeSet whole_page;
+    whole_page.MarkAll();
+    AppendRecord(page_id, page_data, whole_page);
+    num_full_writes_ += 1;
+  } else {
+    AppendRecord(page_id, page_data, dirty_ranges);
+    num_delta_writes_ += 1;
+    if (chains_[page_id].size() > MAX_CHAIN_LENGTH) {
+      ConsolidatePage(page_id);
+    }
+  }
+  MaybeConsolidate();
+}
+
+void DeltaDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  std::unique_lock lock(latch_);
+  auto it = chains_.find(page_id);
+  if (it == chains_.end()) {
+    lock.unlock();
+    disk_manager_->ReadPage(page_id, page_data);
+    return;
+  }
+  FoldPage(page_id, it->second, page_data);
+}
+
+auto DeltaDiskManager::HasChains(page_id_t page_id, size_t num_pages) const -> bool {
+  for (size_t i = 0; i < num_pages; ++i) {
+    if (chains_.count(page_id + static_cast<page_id_t>(i)) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DeltaDiskManager::WritePages(page_id_t page_id, const char *page_data, size_t num_pages) {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    if (!HasChains(page_id, num_pages)) {
+      num_full_writes_ += 1;
+      disk_manager_->WritePages(page_id, page_data, num_pages);
+      for (size_t i = 0; i < num_pages; ++i) {
+        unsynced_base_pages_.insert(page_id + static_cast<page_id_t>(i));
+      }
+      return;
+    }
+  }
+  // Every block with deltas needs a full image in the log to supersede them
+  DiskManager::WritePages(page_id, page_data, num_pages);
+}
+
+void DeltaDiskManager::ReadPages(page_id_t page_id, char *page_data, size_t num_pages) {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    if (HasChains(page_id, num_pages)) {
+      for (size_t i = 0; i < num_pages; ++i) {
+        page_id_t block_id = page_id + static_cast<page_id_t>(i);
+        auto it = chains_.find(block_id);
+        if (it == chains_.end()) {
+          disk_manager_->ReadPage(block_id, page_data + i * BUSTUB_PAGE_SIZE);
+        } else {
+          FoldPage(block_id, it->second, page_data + i * BUSTUB_PAGE_SIZE);
+        }
+      }
+      return;
+    }
+  }
+  disk_manager_->ReadPages(page_id, page_data, num_pages);
+}
+
+void DeltaDiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_lock(latch_);
+  if (chains_.count(page_id) != 0) {
+    // Make sure the deltas are gone for good before the page id can be reused and written to the base directly
+    AppendRecord(page_id, nullptr, DirtyRangeSet());
+    if (fdatasync(delta_fd_) != 0) {
+      throw bustub::Exception("I/O error while syncing delta log");
+    }
+  }
+  disk_manager_->DeallocatePage(page_id);
+}
+
+void DeltaDiskManager::Sync() {
+  std::scoped_lock scoped_lock(latch_);
+  disk_manager_->Sync();
+  unsynced_base_pages_.clear();
+  if (fdatasync(delta_fd_) != 0) {
+    throw bustub::Exception("I/O error while syncing delta log");
+  }
+}
+
+void DeltaDiskManager::ConsolidatePage(page_id_t page_id) {
+  char buffer[BUSTUB_PAGE_SIZE];
+  FoldPage(page_id, chains_[page_id], buffer);
+  disk_manager_->WritePage(page_id, buffer);
+  // The tombstone may only become durable after the folded page, and has to be before the page can be written to
+  // the base directly again
+  disk_manager_->Sync();
+  unsynced_base_pages_.clear();
+  AppendRecord(page_id, nullptr, DirtyRangeSet());
+  if (fdatasync(delta_fd_) != 0) {
+    throw bustub::Exception("I/O error while syncing delta log");
+  }
+}
+
+void DeltaDiskManager::Consolidate() {
+  std::scoped_lock scoped_lock(latch_);
+  ConsolidateUnlocked();
+}
+
+void DeltaDiskManager::ConsolidateUnlocked() {
+  if (log_end_ == 0) {
+    return;
+  }
+  char buffer[BUSTUB_PAGE_SIZE];
+  for (auto &[page_id, chain] : chains_) {
+    FoldPage(page_id, chain, buffer);
+    disk_manager_->WritePage(page_id, buffer);
+  }
+  // The folded pages have to be durable before the deltas are dropped
+  disk_manager_->Sync();
+  unsynced_base_pages_.clear();
+  if (ftruncate(delta_fd_, 0) != 0 || fdatasync(delta_fd_) != 0) {
+    throw bustub::Exception("I/O error while truncating delta log");
+  }
+  chains_.clear();
+  log_end_ = 0;
+  num_consolidations_ += 1;
+}
+
+void DeltaDiskManager::MaybeConsolidate() {
+  if (log_end_ >= max_log_size_) {
+    ConsolidateUnlocked();
+  } else if (consolidation_thread_ != nullptr && log_end_ >= max_log_size_ / 2) {
+    consolidation_cv_.notify_one();
+  }
+}
+
+void DeltaDiskManager::RunConsolidationThread() {
+  std::scoped_lock scoped_lock(latch_);
+  if (consolidation_thread_ != nullptr) {
+    return;
+  }
+  stop_ = false;
+  consolidation_thread_ = std::make_unique<std::thread>([this] { ConsolidationThreadLoop(); });
+}
+
+void DeltaDiskManager::StopConsolidationThread() {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    if (consolidation_thread_ == nullptr) {
+      return;
+    }
+    stop_ = true;
+  }
+  consolidation_cv_.notify_one();
+  consolidation_thread_->join();
+  consolidation_thread_.reset();
+}
+
+void DeltaDiskManager::ConsolidationThreadLoop() {
+  std::unique_lock lock(latch_);
+  while (!stop_) {
+    // Start early, so that the write path rarely has to consolidate by itself
+    consolidation_cv_.wait(lock, [this] { return stop_ || log_end_ >= max_log_size_ / 2; });
+    if (!stop_) {
+      ConsolidateUnlocked();
+    }
+  }
+}
+
+auto DeltaDiskManager::GetNumDeltaWrites() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return num_delta_writes_;
+}
+
+auto DeltaDiskManager::GetNumFullWrites() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return num_full_writes_;
+}
+
+auto DeltaDiskManager::GetDeltaBytesWritten() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return delta_bytes_written_;
+}
+
+auto DeltaDiskManager::GetNumConsolidations() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return num_consolidations_;
+}
+
+auto DeltaDiskManager::GetDeltaLogSize() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return log_end_;
+}
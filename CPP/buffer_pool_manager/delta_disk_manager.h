@@ -0,0 +1,245 @@
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "disk_manager.h"
+
+/**
+ * DeltaDiskManager cuts the write amplification of small updates by storing them as deltas, on top of another
+ * DiskManager that holds the base page images.
+ *
+ * A page written back through WritePageDelta with at most max_delta_bytes modified bytes is not rewritten;
+ * instead, a record with just the modified ranges is appended to a delta log file. Reading a page folds its
+ * deltas, in log order, onto the base image. Deltas are folded back into the base pages (consolidated) when the
+ * log grows past max_log_size, by the background consolidation thread once it is half that size, and for a
+ * single page once it has more than MAX_CHAIN_LENGTH deltas.
+ *
+ * Each delta record is {checksum, page id, number of ranges, payload size} followed by the ranges and their
+ * bytes; a full page image is a record with the single range [0, BUSTUB_PAGE_SIZE), and a record with no
+ * ranges discards the deltas before it. Records are checksummed, and a torn tail is cut off when the log is
+ * reopened. Deltas are absolute byte overwrites, so folding them again onto a base page that already contains
+ * them is harmless, which is what makes a crash in the middle of a consolidation safe. A consolidation holds the
+ * latch, so page I/O waits for it to finish.
+ */
+class DeltaDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new delta disk manager and replays the delta log, if there is one.
+   * @param disk_manager the disk manager that holds the base pages, must outlive this one
+   * @param delta_file the file name of the delta log
+   * @param max_delta_bytes largest number of modified bytes stored as a delta instead of rewriting the page
+   * @param max_log_size size of the delta log that triggers a consolidation on the write path
+   */
+  DeltaDiskManager(DiskManager *disk_manager, const std::string &delta_file,
+                   size_t max_delta_bytes = DEFAULT_MAX_DELTA_BYTES, uint64_t max_log_size = DEFAULT_MAX_LOG_SIZE);
+
+  /**
+   * Stop the consolidation thread and close the delta log. The deltas stay in the log, they are folded in when
+   * the pages are read after reopening.
+   */
+  ~DeltaDiskManager() override;
+
+  /**
+   * Write a whole page. A page without deltas goes straight to the base disk manager, otherwise the image is
+   * appended to the delta log so that it supersedes the deltas before it.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Append the modified ranges of a page to the delta log, or write the whole page if too much of it changed.
+   * @param page_id id of the page
+   * @param page_data raw page data, the whole page
+   * @param dirty_ranges the modified byte ranges
+   */
+  void WritePageDelta(page_id_t page_id, const char *page_data, const DirtyRangeSet &dirty_ranges) override;
+
+  /**
+   * Read the base image of a page and fold its deltas onto it.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Write a multi-block page to the base disk manager in one call. Deltas are only kept for single-block pages,
+   * so if a block still has some, e.g. from before its id was reused, the blocks are written one at a time.
+   * @param page_id id of the first block
+   * @param page_data raw page data, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  void WritePages(page_id_t page_id, const char *page_data, size_t num_pages) override;
+
+  /**
+   * Read a multi-block page from the base disk manager in one call, folding in deltas block by block if it has any.
+   * @param page_id id of the first block
+   * @param[out] page_data output buffer, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  void ReadPages(page_id_t page_id, char *page_data, size_t num_pages) override;
+
+  auto AllocatePage() -> page_id_t override { return disk_manager_->AllocatePage(); }
+
+  auto AllocatePages(size_t num_pages, page_id_t *page_id) -> bool override {
+    return disk_manager_->AllocatePages(num_pages, page_id);
+  }
+
+  void WriteSizeClass(page_id_t page_id, PageSizeClass size_class) override {
+    disk_manager_->WriteSizeClass(page_id, size_class);
+  }
+
+  auto ReadSizeClasses() -> std::vector<std::pair<page_id_t, PageSizeClass>> override {
+    return disk_manager_->ReadSizeClasses();
+  }
+
+  /**
+   * Discard the deltas of a page and deallocate it in the base disk manager.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id) override;
+
+  /**
+   * Make the base pages and the delta log durable.
+   */
+  void Sync() override;
+
+  /** The log belongs to the base disk manager. */
+  void WriteLog(char *log_data, int size) override { disk_manager_->WriteLog(log_data, size); }
+
+  void SyncLog() override { disk_manager_->SyncLog(); }
+
+  auto ReadLog(char *log_data, int size, int offset) -> bool override {
+    return disk_manager_->ReadLog(log_data, size, offset);
+  }
+
+  /**
+   * @brief Fold every delta into its base page and empty the delta log.
+   */
+  void Consolidate();
+
+  /** @brief Start the background consolidation thread. */
+  void RunConsolidationThread();
+
+  /** @brief Stop the background consolidation thread. */
+  void StopConsolidationThread();
+
+  /** @return the number of page writes stored as deltas */
+  auto GetNumDeltaWrites() -> uint64_t;
+
+  /** @return the number of page writes stored as whole pages */
+  auto GetNumFullWrites() -> uint64_t;
+
+  /** @return the number of bytes appended to the delta log */
+  auto GetDeltaBytesWritten() -> uint64_t;
+
+  /** @return the number of times the whole delta log was consolidated */
+  auto GetNumConsolidations() -> uint64_t;
+
+  /** @return the current size of the delta log */
+  auto GetDeltaLogSize() -> uint64_t;
+
+  /** A delta may touch up to a quarter of the page by default. */
+  static constexpr size_t DEFAULT_MAX_DELTA_BYTES = BUSTUB_PAGE_SIZE / 4;
+
+  /** Consolidate once the delta log reaches 64 MB by default. */
+  static constexpr uint64_t DEFAULT_MAX_LOG_SIZE = 64ULL << 20;
+
+  /** Number of deltas a single page may accumulate before it is consolidated on its own. */
+  static constexpr size_t MAX_CHAIN_LENGTH = 16;
+
+ private:
+  /** Header of a delta record, followed by num_ranges_ DirtyRangeSet::Range and then their bytes. */
+  struct RecordHeader {
+    /** CRC-32C of the record after this field. */
+    uint32_t checksum_;
+    page_id_t page_id_;
+    uint32_t num_ranges_;
+    /** Number of bytes after the header. */
+    uint32_t payload_size_;
+  };
+
+  /** Location of one record of a page's delta chain. */
+  struct DeltaRef {
+    uint64_t offset_;
+    uint32_t size_;
+    /** True if the record is a full page image, so the base page need not be read. */
+    bool is_full_;
+  };
+
+  /** Largest possible record: a header, the most ranges a DirtyRangeSet holds and a whole page of bytes. */
+  static constexpr size_t MAX_RECORD_SIZE =
+      sizeof(RecordHeader) + DirtyRangeSet::MAX_RANGES * sizeof(DirtyRangeSet::Range) + BUSTUB_PAGE_SIZE;
+
+  /** @brief Rebuild the delta chains from the log, cutting off a torn tail. */
+  void Recover();
+
+  /**
+   * @brief Append a record to the delta log and update the page's chain. Caller should hold the latch.
+   * @param page_id id of the page
+   * @param page_data raw page data the ranges are taken from, unused for a tombstone
+   * @param dirty_ranges the ranges to store, all of them for a full image, none for a tombstone
+   */
+  void AppendRecord(page_id_t page_id, const char *page_data, const DirtyRangeSet &dirty_ranges);
+
+  /**
+   * @brief Add a record to its page's chain: a full image replaces the chain, a tombstone removes it. Caller
+   * should hold the latch.
+   * @param record the record, header included
+   * @param offset offset of the record in the delta log
+   */
+  void LinkRecord(const char *record, uint64_t offset);
+
+  /** @brief Copy the bytes of a record's ranges into a page. */
+  static void ApplyRecord(const char *record, char *page_data);
+
+  /** @return true if any of the blocks has a delta chain. Caller should hold the latch. */
+  auto HasChains(page_id_t page_id, size_t num_pages) const -> bool;
+
+  /** @brief Read a page's base image and fold its chain onto it. Caller should hold the latch. */
+  void FoldPage(page_id_t page_id, const std::vector<DeltaRef> &chain, char *page_data);
+
+  /** @brief Write a page's folded image to its base page and drop its chain. Caller should hold the latch. */
+  void ConsolidatePage(page_id_t page_id);
+
+  /** @brief Consolidate, with the latch held. */
+  void ConsolidateUnlocked();
+
+  /** @brief Consolidate if the delta log got too large. Caller should hold the latch. */
+  void MaybeConsolidate();
+
+  /** @brief Body of the background consolidation thread. */
+  void ConsolidationThreadLoop();
+
+  DiskManager *disk_manager_;
+  std::string delta_name_;
+  int delta_fd_{-1};
+  const size_t max_delta_bytes_;
+  const uint64_t max_log_size_;
+  /** End of the delta log, where the next record goes. */
+  uint64_t log_end_{0};
+  /** Delta records of each page with deltas, oldest first. A chain may start with a full image. */
+  std::unordered_map<page_id_t, std::vector<DeltaRef>> chains_;
+  /** Pages written to the base disk manager since its last Sync. */
+  std::unordered_set<page_id_t> unsynced_base_pages_;
+
+  uint64_t num_delta_writes_{0};
+  uint64_t num_full_writes_{0};
+  uint64_t delta_bytes_written_{0};
+  uint64_t num_consolidations_{0};
+
+  bool stop_{false};
+  std::unique_ptr<std::thread> consolidation_thread_;
+
+  /** Protects everything above. */
+  std::mutex latch_;
+  /** Wakes up the consolidation thread. */
+  std::condition_variable consolidation_cv_;
+};
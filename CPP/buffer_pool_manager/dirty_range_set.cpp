@@ -0,0 +1,73 @@
+#include "dirty_range_set.h"
+
+#include <algorithm>
+
+void DirtyRangeSet::Add(size_t begin, size_t end) {
+  end = std::min<size_t>(end, BUSTUB_PAGE_SIZE);
+  if (all_ || begin >= end) {
+    return;
+  }
+  if (begin == 0 && end == BUSTUB_PAGE_SIZE) {
+    MarkAll();
+    return;
+  }
+
+  // Insert in order, swallowing every range that overlaps or touches the new one
+  Range merged{static_cast<uint32_t>(begin), static_cast<uint32_t>(end)};
+  Range result[MAX_RANGES + 1];
+  size_t count = 0;
+  bool inserted = false;
+  for (size_t i = 0; i < num_ranges_; ++i) {
+    if (ranges_[i].end_ < merged.begin_) {
+      result[count++] = ranges_[i];
+    } else if (ranges_[i].begin_ > merged.end_) {
+      if (!inserted) {
+        result[count++] = merged;
+        inserted = true;
+      }
+      result[count++] = ranges_[i];
+    } else {
+      merged.begin_ = std::min(merged.begin_, ranges_[i].begin_);
+      merged.end_ = std::max(merged.end_, ranges_[i].end_);
+    }
+  }
+  if (!inserted) {
+    result[count++] = merged;
+  }
+
+  if (count > MAX_RANGES) {
+    // Too many ranges, close the smallest gap
+    size_t closest = 0;
+    for (size_t i = 1; i + 1 < count; ++i) {
+      if (result[i + 1].begin_ - result[i].end_ < result[closest + 1].begin_ - result[closest].end_) {
+        closest = i;
+      }
+    }
+    result[closest].end_ = result[closest + 1].end_;
+    std::copy(result + closest + 2, result + count, result + closest + 1);
+    --count;
+  }
+  std::copy(result, result + count, ranges_);
+  num_ranges_ = count;
+}
+
+void DirtyRangeSet::Merge(const DirtyRangeSet &other) {
+  if (other.all_) {
+    MarkAll();
+    return;
+  }
+  for (const auto &range : other) {
+    Add(range.begin_, range.end_);
+  }
+}
+
+auto DirtyRangeSet::Bytes() const -> size_t {
+  if (all_) {
+    return BUSTUB_PAGE_SIZE;
+  }
+  size_t bytes = 0;
+  for (const auto &range : *this) {
+    bytes += range.end_ - range.begin_;
+  }
+  return bytes;
+}
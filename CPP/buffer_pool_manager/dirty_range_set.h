@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * DirtyRangeSet records which bytes of a page were modified, as a small sorted set of disjoint byte ranges.
+ *
+ * Page guards fill it in through their ranged GetDataMut/AsMut accessors and the buffer pool merges it into
+ * the frame on unpin, so that a page with only a few modified bytes can be written back as a delta. The set
+ * holds at most MAX_RANGES ranges; past that, the two ranges with the smallest gap between them are merged,
+ * which may include a few unmodified bytes but never loses a modified one. A set can also cover the whole
+ * page, which is what any unranged mutable access records.
+ */
+class DirtyRangeSet {
+ public:
+  /** A modified byte range [begin_, end_) of a page. */
+  struct Range {
+    uint32_t begin_;
+    uint32_t end_;
+  };
+
+  /**
+   * @brief Record a modified byte range, merging it with the ranges it overlaps or touches.
+   * @param begin offset of the first modified byte
+   * @param end offset one past the last modified byte, clamped to BUSTUB_PAGE_SIZE
+   */
+  void Add(size_t begin, size_t end);
+
+  /** @brief Record every range of another set. */
+  void Merge(const DirtyRangeSet &other);
+
+  /** @brief Mark the whole page as modified. */
+  void MarkAll() {
+    all_ = true;
+    num_ranges_ = 0;
+  }
+
+  /** @brief Forget every modification. */
+  void Clear() {
+    all_ = false;
+    num_ranges_ = 0;
+  }
+
+  /** @return true if the whole page is modified */
+  auto IsAll() const -> bool { return all_; }
+
+  /** @return true if nothing is modified */
+  auto IsEmpty() const -> bool { return !all_ && num_ranges_ == 0; }
+
+  /** @return the number of modified bytes */
+  auto Bytes() const -> size_t;
+
+  /** @return the number of ranges, 0 if the whole page is modified */
+  auto Size() const -> size_t { return num_ranges_; }
+
+  auto begin() const -> const Range * { return ranges_; }  // NOLINT
+
+  auto end() const -> const Range * { return ranges_ + num_ranges_; }  // NOLINT
+
+  /** Maximum number of ranges kept apart. */
+  static constexpr size_t MAX_RANGES = 8;
+
+ private:
+  Range ranges_[MAX_RANGES];
+  size_t num_ranges_{0};
+  bool all_{false};
+};
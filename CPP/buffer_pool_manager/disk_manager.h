@@ -1,10 +1,19 @@
 #pragma once
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "dirty_range_set.h"
+#include "lock_profiler.h"
+#include "size_class_file.h"
 
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
@@ -34,6 +43,18 @@ class DiskManager {
    */
   virtual void WritePage(page_id_t page_id, const char *page_data);
 
+  /**
+   * Write back a page of which only the given ranges changed since it was last written. Backends that can store
+   * a change as a delta override this, the default writes the whole page.
+   * @param page_id id of the page
+   * @param page_data raw page data, the whole page
+   * @param dirty_ranges the modified byte ranges
+   */
+  virtual void WritePageDelta(page_id_t page_id, const char *page_data,
+                              __attribute__((unused)) const DirtyRangeSet &dirty_ranges) {
+    WritePage(page_id, page_data);
+  }
+
   /**
    * Read a page from the database file.
    * @param page_id id of the page
@@ -41,12 +62,138 @@ class DiskManager {
    */
   virtual void ReadPage(page_id_t page_id, char *page_data);
 
+  /**
+   * Write a page that spans several consecutive page ids, see PageSizeClass. The default writes it one
+   * BUSTUB_PAGE_SIZE block at a time, backends that can do it in one I/O override this.
+   * @param page_id id of the first block
+   * @param page_data raw page data, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  virtual void WritePages(page_id_t page_id, const char *page_data, size_t num_pages) {
+    for (size_t i = 0; i < num_pages; ++i) {
+      WritePage(page_id + static_cast<page_id_t>(i), page_data + i * BUSTUB_PAGE_SIZE);
+    }
+  }
+
+  /**
+   * Read a page that spans several consecutive page ids, see WritePages.
+   * @param page_id id of the first block
+   * @param[out] page_data output buffer, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  virtual void ReadPages(page_id_t page_id, char *page_data, size_t num_pages) {
+    for (size_t i = 0; i < num_pages; ++i) {
+      ReadPage(page_id + static_cast<page_id_t>(i), page_data + i * BUSTUB_PAGE_SIZE);
+    }
+  }
+
+  /**
+   * Allocate a new page on disk. The fstream-based manager leaves page ids to the buffer pool.
+   * @return the id of the allocated page, INVALID_PAGE_ID if the caller should pick page ids itself
+   */
+  virtual auto AllocatePage() -> page_id_t { return INVALID_PAGE_ID; }
+
+  /**
+   * Allocate a run of consecutive page ids, for a page that spans several blocks. The default asks AllocatePage
+   * for one id after the other and gives them back if they don't line up, backends that hand out ids override it.
+   * @param num_pages number of ids
+   * @param[out] page_id the first id of the run, INVALID_PAGE_ID if the caller should pick page ids itself
+   * @return false if no run could be allocated, nothing is allocated then
+   */
+  virtual auto AllocatePages(size_t num_pages, page_id_t *page_id) -> bool {
+    *page_id = AllocatePage();
+    if (*page_id == INVALID_PAGE_ID) {
+      return true;
+    }
+    for (size_t i = 1; i < num_pages; ++i) {
+      page_id_t next_id = AllocatePage();
+      if (next_id != *page_id + static_cast<page_id_t>(i)) {
+        DeallocatePage(next_id);
+        for (size_t j = 0; j < i; ++j) {
+          DeallocatePage(*page_id + static_cast<page_id_t>(j));
+        }
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Release the disk space of a page that is no longer used.
+   * @param page_id id of the page
+   */
+  virtual void DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
+
+  /**
+   * Record the size class of a page that spans several page ids, or Size4K once it is gone, so that the page is
+   * still read whole after a restart. The record is durable when this returns. The default keeps the records in
+   * a SizeClassFile next to the database file, `<db_file>.classes`.
+   * @param page_id id of the page, the first of its page ids
+   * @param size_class its size class
+   */
+  virtual void WriteSizeClass(page_id_t page_id, PageSizeClass size_class) {
+    std::scoped_lock scoped_lock(db_io_latch_);
+    if (!size_class_file_.IsOpen()) {
+      size_class_file_.Open(SizeClassFileName(), true);
+    }
+    size_class_file_.Write(page_id, size_class);
+  }
+
+  /** @return every page recorded by WriteSizeClass with a size class other than Size4K */
+  virtual auto ReadSizeClasses() -> std::vector<std::pair<page_id_t, PageSizeClass>> {
+    std::scoped_lock scoped_lock(db_io_latch_);
+    if (!size_class_file_.IsOpen() && !size_class_file_.Open(SizeClassFileName(), false)) {
+      return {};
+    }
+    return size_class_file_.ReadAll();
+  }
+
+  /**
+   * Make every page written so far durable: flush the stream and fsync the database file. Backends that write
+   * through their own file descriptors override this.
+   */
+  virtual void Sync() {
+    std::scoped_lock scoped_lock(db_io_latch_);
+    if (!db_io_.is_open()) {
+      return;
+    }
+    db_io_.flush();
+    // An fstream has no descriptor to sync, but fsync covers the writes made through any descriptor of the file
+    int fd = open(file_name_.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && fdatasync(fd) == 0;
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (!synced) {
+      throw bustub::Exception("I/O error while syncing " + file_name_);
+    }
+  }
+
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
    * @param size size of log entry
    */
-  void WriteLog(char *log_data, int size);
+  virtual void WriteLog(char *log_data, int size);
+
+  /**
+   * Make every log entry written so far durable: flush the log stream and fsync the log file. LogManager calls
+   * this after each WriteLog. Backends whose WriteLog is durable on its own override this with a no-op.
+   */
+  virtual void SyncLog() {
+    if (!log_io_.is_open()) {
+      return;
+    }
+    log_io_.flush();
+    int fd = open(log_name_.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && fdatasync(fd) == 0;
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (!synced) {
+      throw bustub::Exception("I/O error while syncing " + log_name_);
+    }
+  }
 
   /**
    * Read a log entry from the log file.
@@ -55,7 +202,7 @@ class DiskManager {
    * @param offset offset of the log entry in the file
    * @return true if the read was successful, false otherwise
    */
-  auto ReadLog(char *log_data, int size, int offset) -> bool;
+  virtual auto ReadLog(char *log_data, int size, int offset) -> bool;
 
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
@@ -77,6 +224,11 @@ class DiskManager {
 
  protected:
   auto GetFileSize(const std::string &file_name) -> int;
+
+  auto SizeClassFileName() const -> std::string {
+    return size_class_name_.empty() ? file_name_ + ".classes" : size_class_name_;
+  }
+
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
@@ -88,5 +240,9 @@ class DiskManager {
   bool flush_log_{false};
   std::future<void> *flush_log_f_{nullptr};
   // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  ProfiledMutex<LockSite::DiskIo> db_io_latch_;
+  // size classes of the pages larger than BUSTUB_PAGE_SIZE, opened on first use
+  SizeClassFile size_class_file_;
+  // `<file_name_>.classes` if empty
+  std::string size_class_name_;
 };
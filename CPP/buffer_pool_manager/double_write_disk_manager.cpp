@@ -0,0 +1,213 @@
+#include "double_write_disk_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "crc32c.h"
+
+DoubleWriteDiskManager::DoubleWriteDiskManager(DiskManager *disk_manager, const std::string &double_write_file,
+                                               size_t batch_pages)
+    : disk_manager_(disk_manager),
+      double_write_name_(double_write_file),
+      batch_pages_(std::clamp<size_t>(batch_pages, 1, MAX_BATCH_PAGES)),
+      batch_(new char[(batch_pages_ + 1) * BUSTUB_PAGE_SIZE]),
+      batch_capacity_(batch_pages_) {
+  double_write_fd_ = open(double_write_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (double_write_fd_ < 0) {
+    throw bustub::Exception("can't open double-write file " + double_write_name_);
+  }
+  Recover();
+}
+
+DoubleWriteDiskManager::~DoubleWriteDiskManager() {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    FlushBatch();
+  }
+  close(double_write_fd_);
+}
+
+auto DoubleWriteDiskManager::BatchChecksum(size_t num_pages) -> uint32_t {
+  uint32_t checksum = Crc32c::Compute(reinterpret_cast<const char *>(BatchPageIds()), num_pages * sizeof(page_id_t));
+  return Crc32c::Extend(checksum, BatchPage(0), num_pages * BUSTUB_PAGE_SIZE);
+}
+
+void DoubleWriteDiskManager::Recover() {
+  auto *header = reinterpret_cast<BatchHeader *>(batch_.get());
+  if (pread(double_write_fd_, batch_.get(), BUSTUB_PAGE_SIZE, 0) != static_cast<ssize_t>(BUSTUB_PAGE_SIZE) ||
+      header->magic_ != MAGIC || header->num_pages_ == 0 || header->num_pages_ > MAX_BATCH_PAGES) {
+    return;
+  }
+  size_t num_pages = header->num_pages_;
+  // The batch on disk may be larger than the one configured now
+  std::unique_ptr<char[]> batch(new char[(num_pages + 1) * BUSTUB_PAGE_SIZE]);
+  std::swap(batch, batch_);
+  auto size = static_cast<ssize_t>((num_pages + 1) * BUSTUB_PAGE_SIZE);
+  bool intact = pread(double_write_fd_, batch_.get(), size, 0) == size &&
+                reinterpret_cast<BatchHeader *>(batch_.get())->checksum_ == BatchChecksum(num_pages);
+  if (intact) {
+    // Some of these may have been torn, and rewriting the others is harmless
+    WriteBatchInPlace(num_pages);
+    disk_manager_->Sync();
+    num_restored_pages_ = num_pages;
+  }
+  std::swap(batch, batch_);
+  // Done with it either way: a torn batch was never written in place
+  if (ftruncate(double_write_fd_, 0) != 0 || fdatasync(double_write_fd_) != 0) {
+    throw bustub::Exception("I/O error while clearing double-write file");
+  }
+}
+
+void DoubleWriteDiskManager::FlushBatch() {
+  if (num_pending_ == 0) {
+    return;
+  }
+  auto *header = reinterpret_cast<BatchHeader *>(batch_.get());
+  header->magic_ = MAGIC;
+  header->num_pages_ = static_cast<uint32_t>(num_pending_);
+  header->checksum_ = BatchChecksum(num_pending_);
+  header->reserved_ = 0;
+
+  // One sequential write and one fsync for the whole batch
+  auto size = static_cast<ssize_t>((num_pending_ + 1) * BUSTUB_PAGE_SIZE);
+  if (pwrite(double_write_fd_, batch_.get(), size, 0) != size || fdatasync(double_write_fd_) != 0) {
+    throw bustub::Exception("I/O error while writing double-write file");
+  }
+  // Now the pages can be torn in place, there is a good copy to repair them from
+  WriteBatchInPlace(num_pending_);
+  // The next batch overwrites the double-write file, so this one has to be in place for good first
+  disk_manager_->Sync();
+
+  num_pending_ = 0;
+  pending_pages_.clear();
+  num_batches_ += 1;
+}
+
+void DoubleWriteDiskManager::WriteBatchInPlace(size_t num_pages) {
+  for (size_t i = 0; i < num_pages;) {
+    size_t extent = 1;
+    while (i + extent < num_pages && BatchPageIds()[i + extent] == EXTENT_CONTINUATION) {
+      ++extent;
+    }
+    if (extent == 1) {
+      disk_manager_->WritePage(BatchPageIds()[i], BatchPage(i));
+    } else {
+      disk_manager_->WritePages(BatchPageIds()[i], BatchPage(i), extent);
+    }
+    i += extent;
+  }
+}
+
+void DoubleWriteDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  std::scoped_lock scoped_lock(latch_);
+  AddToBatch(page_id, page_data, 1);
+}
+
+void DoubleWriteDiskManager::WritePages(page_id_t page_id, const char *page_data, size_t num_pages) {
+  std::scoped_lock scoped_lock(latch_);
+  AddToBatch(page_id, page_data, num_pages);
+}
+
+void DoubleWriteDiskManager::AddToBatch(page_id_t page_id, const char *page_data, size_t num_pages) {
+  auto it = pending_pages_.find(page_id);
+  if (it != pending_pages_.end()) {
+    if (it->second.num_pages_ == num_pages) {
+      // Already waiting in this batch, only the newest image has to be written
+      memcpy(BatchPage(it->second.slot_), page_data, num_pages * BUSTUB_PAGE_SIZE);
+      return;
+    }
+    // Written again with another size, the old image goes in place first
+    FlushBatch();
+  }
+  if (num_pending_ + num_pages > batch_capacity_) {
+    FlushBatch();
+    if (num_pages > batch_capacity_) {
+      if (num_pages > MAX_BATCH_PAGES) {
+        throw bustub::Exception("page too large for the double-write buffer");
+      }
+      batch_.reset(new char[(num_pages + 1) * BUSTUB_PAGE_SIZE]);
+      batch_capacity_ = num_pages;
+    }
+  }
+  BatchPageIds()[num_pending_] = page_id;
+  for (size_t i = 1; i < num_pages; ++i) {
+    BatchPageIds()[num_pending_ + i] = EXTENT_CONTINUATION;
+  }
+  memcpy(BatchPage(num_pending_), page_data, num_pages * BUSTUB_PAGE_SIZE);
+  pending_pages_[page_id] = {num_pending_, num_pages};
+  num_pending_ += num_pages;
+  if (num_pending_ >= batch_pages_) {
+    FlushBatch();
+  }
+}
+
+void DoubleWriteDiskManager::ReadPage(page_id_t page_id, char *page_data) { ReadPending(page_id, page_data, 1); }
+
+void DoubleWriteDiskManager::ReadPages(page_id_t page_id, char *page_data, size_t num_pages) {
+  ReadPending(page_id, page_data, num_pages);
+}
+
+void DoubleWriteDiskManager::ReadPending(page_id_t page_id, char *page_data, size_t num_pages) {
+  std::unique_lock lock(latch_);
+  auto it = pending_pages_.find(page_id);
+  if (it != pending_pages_.end()) {
+    if (it->second.num_pages_ == num_pages) {
+      memcpy(page_data, BatchPage(it->second.slot_), num_pages * BUSTUB_PAGE_SIZE);
+      return;
+    }
+    // Read with another size than it was written with, let the wrapped disk manager sort it out
+    FlushBatch();
+  }
+  // Not pending, so not written in place concurrently either: the latch is not needed for the read
+  lock.unlock();
+  if (num_pages == 1) {
+    disk_manager_->ReadPage(page_id, page_data);
+  } else {
+    disk_manager_->ReadPages(page_id, page_data, num_pages);
+  }
+}
+
+void DoubleWriteDiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_lock(latch_);
+  auto it = pending_pages_.find(page_id);
+  if (it != pending_pages_.end()) {
+    size_t slot = it->second.slot_;
+    size_t last = num_pending_ - 1;
+    if (it->second.num_pages_ != 1 || BatchPageIds()[last] == EXTENT_CONTINUATION) {
+      // Slots of a multi-block page can't be moved around one at a time, write the batch out instead
+      FlushBatch();
+    } else {
+      // Move the last page of the batch into the freed slot
+      pending_pages_.erase(it);
+      if (slot != last) {
+        BatchPageIds()[slot] = BatchPageIds()[last];
+        memcpy(BatchPage(slot), BatchPage(last), BUSTUB_PAGE_SIZE);
+        pending_pages_[BatchPageIds()[slot]].slot_ = slot;
+      }
+      num_pending_ -= 1;
+    }
+  }
+  disk_manager_->DeallocatePage(page_id);
+}
+
+void DoubleWriteDiskManager::Sync() {
+  std::scoped_lock scoped_lock(latch_);
+  if (num_pending_ == 0) {
+    disk_manager_->Sync();
+    return;
+  }
+  FlushBatch();
+}
+
+auto DoubleWriteDiskManager::GetNumBatches() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return num_batches_;
+}
+
+auto DoubleWriteDiskManager::GetNumRestoredPages() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  return num_restored_pages_;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+
+#include "disk_manager.h"
+
+/**
+ * DoubleWriteDiskManager protects the pages of another DiskManager against torn writes with a double-write buffer.
+ *
+ * Written pages are collected into a batch in memory. Once the batch is full, or on Sync, the whole batch is
+ * written sequentially to the double-write file in a single I/O and made durable with a single fsync, and only
+ * then are the pages written in place through the wrapped disk manager, followed by its Sync. A crash can tear
+ * either the double-write file, in which case no page of the batch was written in place yet, or an in-place page,
+ * in which case an intact copy sits in the double-write file. When the manager is opened, an intact batch found
+ * in the double-write file is written in place again, which repairs any page torn by the crash. Every page of
+ * the last batch is at least as new as its in-place copy, so rewriting them all is always safe.
+ *
+ * Compared with an fsync per page, a batch of n pages costs two fsyncs, and the double write itself is one large
+ * sequential I/O. Pages waiting in the batch are served from memory.
+ *
+ * The double-write file holds one header page {magic, number of pages, checksum, page ids} followed by the pages.
+ * A multi-block page written through WritePages takes consecutive slots of the batch: the first slot has its page
+ * id and the others EXTENT_CONTINUATION, and it is written in place with a single WritePages.
+ */
+class DoubleWriteDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new double-write disk manager and repairs the pages of the last batch, if it is intact.
+   * @param disk_manager the disk manager that writes pages in place, must outlive this one
+   * @param double_write_file the file name of the double-write buffer
+   * @param batch_pages number of pages per batch, capped at what the header page can describe
+   */
+  DoubleWriteDiskManager(DiskManager *disk_manager, const std::string &double_write_file,
+                         size_t batch_pages = DEFAULT_BATCH_PAGES);
+
+  /**
+   * Write out the pending batch and close the double-write file.
+   */
+  ~DoubleWriteDiskManager() override;
+
+  /**
+   * Add a page to the current batch, writing the batch out once it is full.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Read a page, from the current batch if it is waiting there.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Add a multi-block page to the current batch as a whole, writing the batch out first if it doesn't fit. A page
+   * larger than the batch gets a batch of its own.
+   * @param page_id id of the first block
+   * @param page_data raw page data, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks, at most what the header page can describe
+   */
+  void WritePages(page_id_t page_id, const char *page_data, size_t num_pages) override;
+
+  /**
+   * Read a multi-block page, from the current batch if it is waiting there.
+   * @param page_id id of the first block
+   * @param[out] page_data output buffer, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  void ReadPages(page_id_t page_id, char *page_data, size_t num_pages) override;
+
+  auto AllocatePage() -> page_id_t override { return disk_manager_->AllocatePage(); }
+
+  auto AllocatePages(size_t num_pages, page_id_t *page_id) -> bool override {
+    return disk_manager_->AllocatePages(num_pages, page_id);
+  }
+
+  void WriteSizeClass(page_id_t page_id, PageSizeClass size_class) override {
+    disk_manager_->WriteSizeClass(page_id, size_class);
+  }
+
+  auto ReadSizeClasses() -> std::vector<std::pair<page_id_t, PageSizeClass>> override {
+    return disk_manager_->ReadSizeClasses();
+  }
+
+  /**
+   * Drop the page from the current batch and deallocate it in the wrapped disk manager.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id) override;
+
+  /**
+   * Write out the pending batch, which leaves every page written so far durable.
+   */
+  void Sync() override;
+
+  /** The log is append-only and not subject to torn page writes, it goes straight to the wrapped disk manager. */
+  void WriteLog(char *log_data, int size) override { disk_manager_->WriteLog(log_data, size); }
+
+  void SyncLog() override { disk_manager_->SyncLog(); }
+
+  auto ReadLog(char *log_data, int size, int offset) -> bool override {
+    return disk_manager_->ReadLog(log_data, size, offset);
+  }
+
+  /** @return the number of batches written */
+  auto GetNumBatches() -> uint64_t;
+
+  /** @return the number of pages repaired from the double-write file when the manager was opened */
+  auto GetNumRestoredPages() -> uint64_t;
+
+  /** 64 pages per batch by default. */
+  static constexpr size_t DEFAULT_BATCH_PAGES = 64;
+
+ private:
+  /** Leading fields of the header page, followed by the page ids. */
+  struct BatchHeader {
+    uint32_t magic_;
+    uint32_t num_pages_;
+    /** CRC-32C of the page ids and the pages. */
+    uint32_t checksum_;
+    uint32_t reserved_;
+  };
+
+  static constexpr uint32_t MAGIC = 0x44574231;
+
+  /** Page id of the slots after the first one of a multi-block page. */
+  static constexpr page_id_t EXTENT_CONTINUATION = INVALID_PAGE_ID;
+
+  /** Where a page waits in the current batch. */
+  struct PendingPage {
+    size_t slot_;
+    size_t num_pages_;
+  };
+
+  /** Largest batch a header page can describe. */
+  static constexpr size_t MAX_BATCH_PAGES = (BUSTUB_PAGE_SIZE - sizeof(BatchHeader)) / sizeof(page_id_t);
+
+  /** @return the page ids stored in the header page of the batch buffer */
+  auto BatchPageIds() -> page_id_t * { return reinterpret_cast<page_id_t *>(batch_.get() + sizeof(BatchHeader)); }
+
+  /** @return the slot of the batch buffer that holds the i-th page */
+  auto BatchPage(size_t i) -> char * { return batch_.get() + (i + 1) * BUSTUB_PAGE_SIZE; }
+
+  /** @brief Write the double-write file, then the pages in place. Caller should hold the latch. */
+  void FlushBatch();
+
+  /** @brief Write the pages of the batch buffer in place, a multi-block page at a time. */
+  void WriteBatchInPlace(size_t num_pages);
+
+  /** @brief WritePages for any number of blocks. Caller should hold the latch. */
+  void AddToBatch(page_id_t page_id, const char *page_data, size_t num_pages);
+
+  /** @brief ReadPages for any number of blocks. */
+  void ReadPending(page_id_t page_id, char *page_data, size_t num_pages);
+
+  /** @brief Rewrite the pages of an intact batch found in the double-write file. */
+  void Recover();
+
+  /** @return the checksum of the page ids and pages of the batch in the batch buffer */
+  auto BatchChecksum(size_t num_pages) -> uint32_t;
+
+  DiskManager *disk_manager_;
+  std::string double_write_name_;
+  int double_write_fd_{-1};
+  const size_t batch_pages_;
+  /** Header page followed by batch_capacity_ pages, laid out exactly like the double-write file. */
+  std::unique_ptr<char[]> batch_;
+  /** Pages the batch buffer holds, batch_pages_ unless a larger multi-block page came along. */
+  size_t batch_capacity_;
+  /** Number of blocks in the current batch. */
+  size_t num_pending_{0};
+  /** Slots of each page in the current batch, by the id of its first block. */
+  std::unordered_map<page_id_t, PendingPage> pending_pages_;
+  uint64_t num_batches_{0};
+  uint64_t num_restored_pages_{0};
+  /** Protects the batch and the counters. */
+  std::mutex latch_;
+};
@@ -0,0 +1,218 @@
+#include "lock_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace {
+
+/** The counters of one latch on one thread. Only the owning thread writes them, Collect reads them concurrently. */
+struct SiteCounters {
+  std::atomic<uint64_t> acquisitions_{0};
+  std::atomic<uint64_t> contended_{0};
+  std::atomic<uint64_t> wait_ns_{0};
+  std::atomic<uint64_t> hold_ns_{0};
+  std::atomic<uint64_t> wait_histogram_[LockProfiler::NUM_BUCKETS]{};
+  std::atomic<uint64_t> hold_histogram_[LockProfiler::NUM_BUCKETS]{};
+};
+
+/** A shared hold being timed, see LockProfiler::BeginHold. */
+struct HoldSlot {
+  const void *latch_{nullptr};
+  uint64_t start_{0};
+};
+
+constexpr size_t MAX_TIMED_HOLDS = 8;
+
+const char *const SITE_NAMES[NUM_LOCK_SITES] = {"buffer_pool", "replacer", "disk_io", "page"};
+
+/** A single writer, so a plain load and store instead of a locked read-modify-write. */
+void Bump(std::atomic<uint64_t> *counter, uint64_t n) {
+  counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+auto BucketOf(uint64_t ns) -> size_t {
+  if (ns == 0) {
+    return 0;
+  }
+  auto bucket = static_cast<size_t>(64 - __builtin_clzll(ns));
+  return std::min(bucket, LockProfiler::NUM_BUCKETS - 1);
+}
+
+void AddTo(const SiteCounters &counters, LockProfiler::Stats *stats) {
+  stats->acquisitions_ += counters.acquisitions_.load(std::memory_order_relaxed);
+  stats->contended_ += counters.contended_.load(std::memory_order_relaxed);
+  stats->wait_ns_ += counters.wait_ns_.load(std::memory_order_relaxed);
+  stats->hold_ns_ += counters.hold_ns_.load(std::memory_order_relaxed);
+  for (size_t b = 0; b < LockProfiler::NUM_BUCKETS; ++b) {
+    stats->wait_histogram_[b] += counters.wait_histogram_[b].load(std::memory_order_relaxed);
+    stats->hold_histogram_[b] += counters.hold_histogram_[b].load(std::memory_order_relaxed);
+  }
+}
+
+/** The threads' counters, and the totals of the threads that have exited. */
+struct Registry {
+  std::mutex latch_;
+  std::vector<SiteCounters *> live_;
+  LockProfiler::Stats retired_[NUM_LOCK_SITES];
+};
+
+auto GetRegistry() -> Registry & {
+  // Constructed before any thread registers, so it outlives every thread's counters
+  static Registry registry;
+  return registry;
+}
+
+/** The calling thread's counters, registered for as long as the thread lives. */
+struct ThreadCounters {
+  ThreadCounters() {
+    Registry &registry = GetRegistry();
+    std::scoped_lock scoped_lock(registry.latch_);
+    registry.live_.push_back(sites_);
+  }
+
+  ~ThreadCounters() {
+    Registry &registry = GetRegistry();
+    std::scoped_lock scoped_lock(registry.latch_);
+    for (size_t i = 0; i < NUM_LOCK_SITES; ++i) {
+      AddTo(sites_[i], &registry.retired_[i]);
+    }
+    auto &live = registry.live_;
+    for (auto it = live.begin(); it != live.end(); ++it) {
+      if (*it == sites_) {
+        live.erase(it);
+        break;
+      }
+    }
+  }
+
+  SiteCounters sites_[NUM_LOCK_SITES];
+  HoldSlot holds_[MAX_TIMED_HOLDS];
+};
+
+auto GetThreadCounters() -> ThreadCounters & {
+  static thread_local ThreadCounters thread_counters;
+  return thread_counters;
+}
+
+}  // namespace
+
+auto LockProfiler::IsEnabled() -> bool {
+#ifdef BUSTUB_LOCK_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void LockProfiler::RecordAcquire(LockSite site, bool contended, uint64_t wait_ns) {
+  SiteCounters &counters = GetThreadCounters().sites_[static_cast<size_t>(site)];
+  Bump(&counters.acquisitions_, 1);
+  Bump(&counters.wait_histogram_[BucketOf(wait_ns)], 1);
+  if (contended) {
+    Bump(&counters.contended_, 1);
+    Bump(&counters.wait_ns_, wait_ns);
+  }
+}
+
+void LockProfiler::RecordRelease(LockSite site, uint64_t hold_ns) {
+  SiteCounters &counters = GetThreadCounters().sites_[static_cast<size_t>(site)];
+  Bump(&counters.hold_ns_, hold_ns);
+  Bump(&counters.hold_histogram_[BucketOf(hold_ns)], 1);
+}
+
+void LockProfiler::BeginHold(const void *latch) {
+  for (auto &slot : GetThreadCounters().holds_) {
+    if (slot.latch_ == nullptr) {
+      slot = HoldSlot{latch, Now()};
+      return;
+    }
+  }
+}
+
+void LockProfiler::EndHold(LockSite site, const void *latch) {
+  for (auto &slot : GetThreadCounters().holds_) {
+    if (slot.latch_ == latch) {
+      uint64_t start = slot.start_;
+      slot = HoldSlot{};
+      RecordRelease(site, Now() - start);
+      return;
+    }
+  }
+}
+
+auto LockProfiler::Collect(LockSite site) -> Stats {
+  auto i = static_cast<size_t>(site);
+  Registry &registry = GetRegistry();
+  std::scoped_lock scoped_lock(registry.latch_);
+  Stats stats = registry.retired_[i];
+  for (const SiteCounters *sites : registry.live_) {
+    AddTo(sites[i], &stats);
+  }
+  return stats;
+}
+
+void LockProfiler::Reset() {
+  Registry &registry = GetRegistry();
+  std::scoped_lock scoped_lock(registry.latch_);
+  for (auto &stats : registry.retired_) {
+    stats = Stats{};
+  }
+  for (SiteCounters *sites : registry.live_) {
+    for (size_t i = 0; i < NUM_LOCK_SITES; ++i) {
+      SiteCounters &counters = sites[i];
+      counters.acquisitions_.store(0, std::memory_order_relaxed);
+      counters.contended_.store(0, std::memory_order_relaxed);
+      counters.wait_ns_.store(0, std::memory_order_relaxed);
+      counters.hold_ns_.store(0, std::memory_order_relaxed);
+      for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+        counters.wait_histogram_[b].store(0, std::memory_order_relaxed);
+        counters.hold_histogram_[b].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+auto LockProfiler::Stats::Percentile(const uint64_t (&histogram)[NUM_BUCKETS], double percentile) -> uint64_t {
+  uint64_t total = 0;
+  for (uint64_t count : histogram) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(percentile / 100 * static_cast<double>(total));
+  uint64_t seen = 0;
+  for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+    seen += histogram[b];
+    if (seen > rank || seen == total) {
+      return b == 0 ? 0 : uint64_t{1} << b;
+    }
+  }
+  return uint64_t{1} << (NUM_BUCKETS - 1);
+}
+
+void LockProfiler::Dump(std::ostream &os) {
+  if (!IsEnabled()) {
+    os << "lock profiling is disabled, build with BUSTUB_LOCK_PROFILING defined\n";
+    return;
+  }
+  os << std::left << std::setw(12) << "latch" << std::right << std::setw(12) << "acquired" << std::setw(12)
+     << "contended" << std::setw(14) << "wait avg ns" << std::setw(12) << "wait p99" << std::setw(14)
+     << "hold avg ns" << std::setw(12) << "hold p50" << std::setw(12) << "hold p99" << '\n';
+  for (size_t i = 0; i < NUM_LOCK_SITES; ++i) {
+    Stats stats = Collect(static_cast<LockSite>(i));
+    // Wait time is only spent on contended acquisitions
+    uint64_t wait_avg = stats.contended_ == 0 ? 0 : stats.wait_ns_ / stats.contended_;
+    uint64_t holds = 0;
+    for (uint64_t count : stats.hold_histogram_) {
+      holds += count;
+    }
+    uint64_t hold_avg = holds == 0 ? 0 : stats.hold_ns_ / holds;
+    os << std::left << std::setw(12) << SITE_NAMES[i] << std::right << std::setw(12) << stats.acquisitions_
+       << std::setw(12) << stats.contended_ << std::setw(14) << wait_avg << std::setw(12)
+       << Stats::Percentile(stats.wait_histogram_, 99) << std::setw(14) << hold_avg << std::setw(12)
+       << Stats::Percentile(stats.hold_histogram_, 50) << std::setw(12)
+       << Stats::Percentile(stats.hold_histogram_, 99) << '\n';
+  }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <ostream>
+
+/** The latches LockProfiler keeps apart. */
+enum class LockSite { BufferPool = 0, Replacer, DiskIo, Page };
+
+static constexpr size_t NUM_LOCK_SITES = 4;
+
+/**
+ * LockProfiler records how long threads wait for and hold the hot latches: the buffer pool latch, the replacer
+ * latch, the disk manager's I/O latch and the page latches. Build with BUSTUB_LOCK_PROFILING defined to enable
+ * it; otherwise the latches are the plain types and none of this is compiled in.
+ *
+ * For each latch it counts acquisitions and contended acquisitions, those that could not take the latch right
+ * away, and keeps log2 histograms of the wait and hold times in nanoseconds. Every thread records into its own
+ * histograms, so recording is a few uncontended stores next to two clock reads; Dump and Collect add up the
+ * histograms of all threads, including those that have exited.
+ */
+class LockProfiler {
+ public:
+  /** Histogram buckets: bucket b counts durations in [2^(b-1), 2^b) ns, bucket 0 counts zero. */
+  static constexpr size_t NUM_BUCKETS = 40;
+
+  /** The statistics of one latch. */
+  struct Stats {
+    uint64_t acquisitions_{0};
+    uint64_t contended_{0};
+    uint64_t wait_ns_{0};
+    uint64_t hold_ns_{0};
+    uint64_t wait_histogram_[NUM_BUCKETS]{};
+    uint64_t hold_histogram_[NUM_BUCKETS]{};
+
+    /** @return an upper bound of the given percentile of a histogram, in ns */
+    static auto Percentile(const uint64_t (&histogram)[NUM_BUCKETS], double percentile) -> uint64_t;
+  };
+
+  /** @return true if the latches are profiled, i.e. the build defines BUSTUB_LOCK_PROFILING */
+  static auto IsEnabled() -> bool;
+
+  /**
+   * @brief Add up the statistics of one latch over all threads.
+   * @param site the latch
+   * @return the statistics, all zero if profiling is disabled
+   */
+  static auto Collect(LockSite site) -> Stats;
+
+  /** @brief Write a table of the statistics of every latch, one line each. */
+  static void Dump(std::ostream &os);
+
+  /** @brief Zero the statistics of every thread. Should not race with latching. */
+  static void Reset();
+
+  /** @brief Record an acquisition. Called by the profiled latches. */
+  static void RecordAcquire(LockSite site, bool contended, uint64_t wait_ns);
+
+  /** @brief Record the release of a hold that lasted hold_ns. Called by the profiled latches. */
+  static void RecordRelease(LockSite site, uint64_t hold_ns);
+
+  /**
+   * @brief Remember when the calling thread acquired a latch, for latches that can be held by several threads
+   * at once and so cannot keep the time themselves. A thread tracks a handful of such holds at a time, the
+   * holds beyond that are counted but not timed.
+   * @param latch the latch
+   */
+  static void BeginHold(const void *latch);
+
+  /**
+   * @brief Record the release of a hold started with BeginHold.
+   * @param site the latch's site
+   * @param latch the latch
+   */
+  static void EndHold(LockSite site, const void *latch);
+
+  /** @return the current time in ns, on the clock the profiler uses */
+  static auto Now() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+#ifdef BUSTUB_LOCK_PROFILING
+
+/**
+ * ProfiledMutex is a std::mutex that reports to LockProfiler. It meets the Lockable requirements, so it works
+ * with std::scoped_lock and std::unique_lock; waiting on it needs ProfiledConditionVariable.
+ */
+template <LockSite Site>
+class ProfiledMutex {
+ public:
+  void lock() {  // NOLINT
+    if (mutex_.try_lock()) {
+      LockProfiler::RecordAcquire(Site, false, 0);
+    } else {
+      uint64_t start = LockProfiler::Now();
+      mutex_.lock();
+      LockProfiler::RecordAcquire(Site, true, LockProfiler::Now() - start);
+    }
+    acquired_ = LockProfiler::Now();
+  }
+
+  auto try_lock() -> bool {  // NOLINT
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+    LockProfiler::RecordAcquire(Site, false, 0);
+    acquired_ = LockProfiler::Now();
+    return true;
+  }
+
+  void unlock() {  // NOLINT
+    // Only the holder touches acquired_
+    uint64_t hold_ns = LockProfiler::Now() - acquired_;
+    mutex_.unlock();
+    LockProfiler::RecordRelease(Site, hold_ns);
+  }
+
+ private:
+  std::mutex mutex_;
+  uint64_t acquired_{0};
+};
+
+using ProfiledConditionVariable = std::condition_variable_any;
+
+#else
+
+template <LockSite Site>
+using ProfiledMutex = std::mutex;
+
+using ProfiledConditionVariable = std::condition_variable;
+
+#endif
@@ -0,0 +1,41 @@
+#include "log_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+void LogFile::Open(const std::string &file_name) {
+  fd_ = open(file_name.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    throw bustub::Exception("can't open log file " + file_name);
+  }
+}
+
+void LogFile::Close() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void LogFile::Append(const char *log_data, int size) {
+  if (size == 0) {
+    return;
+  }
+  // O_APPEND makes every write land at the end on its own, so concurrent appends need no latch
+  if (write(fd_, log_data, size) != size || fdatasync(fd_) != 0) {
+    throw bustub::Exception("I/O error while writing log");
+  }
+}
+
+auto LogFile::Read(char *log_data, int size, int offset) -> bool {
+  ssize_t read_count = pread(fd_, log_data, size, offset);
+  if (read_count <= 0) {
+    return false;
+  }
+  if (read_count < size) {
+    memset(log_data + read_count, 0, size - read_count);
+  }
+  return true;
+}
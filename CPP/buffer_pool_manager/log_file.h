@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+/**
+ * LogFile is the log of a disk manager that does its own file I/O instead of going through the fstreams of
+ * DiskManager: an append-only file written through a file descriptor, each append made durable before it returns.
+ */
+class LogFile {
+ public:
+  LogFile() = default;
+
+  DISALLOW_COPY_AND_MOVE(LogFile);
+
+  ~LogFile() { Close(); }
+
+  /**
+   * @brief Open the log file, creating it if it doesn't exist.
+   * @param file_name the file name of the log file
+   */
+  void Open(const std::string &file_name);
+
+  /** @brief Close the log file. */
+  void Close();
+
+  /**
+   * @brief Append to the log file and make it durable.
+   * @param log_data raw log data
+   * @param size size of log entry
+   */
+  void Append(const char *log_data, int size);
+
+  /**
+   * @brief Read a log entry from the log file. Bytes past the end of the file read as zeroes.
+   * @param[out] log_data output buffer
+   * @param size size of the log entry
+   * @param offset offset of the log entry in the file
+   * @return true if the read was successful, false if there is nothing at the offset
+   */
+  auto Read(char *log_data, int size, int offset) -> bool;
+
+ private:
+  int fd_{-1};
+};
@@ -0,0 +1,117 @@
+#include "log_manager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+LogManager::LogManager(DiskManager *disk_manager)
+    : disk_manager_(disk_manager),
+      log_buffer_(std::make_unique<char[]>(LOG_BUFFER_SIZE)),
+      flush_buffer_(std::make_unique<char[]>(LOG_BUFFER_SIZE)) {}
+
+LogManager::~LogManager() { StopFlushThread(); }
+
+void LogManager::RunFlushThread() {
+  std::scoped_lock scoped_lock(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  stop_ = false;
+  flush_thread_ = std::make_unique<std::thread>([this] { FlushThreadLoop(); });
+}
+
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock scoped_lock(latch_);
+    if (flush_thread_ == nullptr) {
+      return;
+    }
+    stop_ = true;
+  }
+  flush_cv_.notify_one();
+  flush_thread_->join();
+  flush_thread_.reset();
+}
+
+void LogManager::FlushThreadLoop() {
+  std::unique_lock lock(latch_);
+  while (!stop_) {
+    // Wake up on request, when the buffer fills up, or periodically so that nothing lingers in memory for long
+    flush_cv_.wait_for(lock, log_timeout, [this] { return flush_requested_ || stop_; });
+    FlushBuffer(&lock);
+  }
+  // Whatever was appended before the stop still has to reach the disk
+  FlushBuffer(&lock);
+}
+
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> *lock) {
+  // Only one flush at a time, the other one will pick up our records
+  durable_cv_.wait(*lock, [this] { return !flush_in_progress_; });
+  flush_requested_ = false;
+  if (log_buffer_offset_ == 0) {
+    return;
+  }
+
+  std::swap(log_buffer_, flush_buffer_);
+  size_t size = log_buffer_offset_;
+  lsn_t flushed_lsn = last_buffered_lsn_;
+  log_buffer_offset_ = 0;
+  flush_in_progress_ = true;
+  // Appenders may use the other buffer right away
+  durable_cv_.notify_all();
+
+  lock->unlock();
+  disk_manager_->WriteLog(flush_buffer_.get(), static_cast<int>(size));
+  // Written is not durable yet, and WaitForDurable callers are about to be told it is
+  disk_manager_->SyncLog();
+  lock->lock();
+
+  flush_in_progress_ = false;
+  persistent_lsn_ = flushed_lsn;
+  num_flushes_ += 1;
+  durable_cv_.notify_all();
+}
+
+auto LogManager::AppendLogRecord(const char *record, size_t size) -> lsn_t {
+  size_t total = sizeof(RecordHeader) + size;
+  if (total > LOG_BUFFER_SIZE) {
+    throw std::invalid_argument("log record larger than the log buffer");
+  }
+
+  std::unique_lock lock(latch_);
+  while (log_buffer_offset_ + total > LOG_BUFFER_SIZE) {
+    // Buffer full: hand it to the flush thread and wait until it's swapped out
+    flush_requested_ = true;
+    if (flush_thread_ != nullptr) {
+      flush_cv_.notify_one();
+      durable_cv_.wait(lock, [&] { return log_buffer_offset_ + total <= LOG_BUFFER_SIZE; });
+    } else {
+      FlushBuffer(&lock);
+    }
+  }
+
+  RecordHeader header{static_cast<uint32_t>(total), next_lsn_};
+  memcpy(log_buffer_.get() + log_buffer_offset_, &header, sizeof(header));
+  memcpy(log_buffer_.get() + log_buffer_offset_ + sizeof(header), record, size);
+  log_buffer_offset_ += total;
+  last_buffered_lsn_ = next_lsn_++;
+  return last_buffered_lsn_;
+}
+
+void LogManager::WaitForDurable(lsn_t lsn) {
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  std::unique_lock lock(latch_);
+  // A page LSN that was never handed out (e.g. a page that was never logged) needs nothing newer than what we have
+  lsn = std::min<lsn_t>(lsn, next_lsn_ - 1);
+  while (persistent_lsn_ < lsn) {
+    if (flush_thread_ == nullptr) {
+      FlushBuffer(&lock);
+      continue;
+    }
+    // Group commit: everyone waiting here is served by the same flush
+    flush_requested_ = true;
+    flush_cv_.notify_one();
+    durable_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+#include "disk_manager.h"
+
+/** Type tag at the start of the log records written by the storage layer itself. */
+enum class LogRecordType : uint32_t { Invalid = 0, Checkpoint };
+
+/**
+ * Record written when a fuzzy checkpoint completes. Every change with an LSN below min_recovery_lsn_ is on disk,
+ * so recovery can start its redo pass there.
+ */
+struct CheckpointRecord {
+  LogRecordType type_{LogRecordType::Checkpoint};
+  lsn_t min_recovery_lsn_;
+};
+
+/**
+ * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
+ * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * The log is double-buffered: appenders keep filling one buffer while the flush thread writes the other, so
+ * appending never waits for I/O unless both buffers are full. Commits are grouped: every caller of
+ * WaitForDurable while a flush is in progress is served by the next flush, so many concurrent transactions share
+ * one DiskManager::WriteLog and SyncLog instead of paying one each.
+ *
+ * Each record is stored with a small header {size, lsn} followed by its payload. LSNs are handed out densely
+ * starting at 0, and a page whose LSN is L may only be written back once GetPersistentLSN() >= L.
+ */
+class LogManager {
+ public:
+  /**
+   * @brief Creates a new LogManager. The flush thread is not started, see RunFlushThread.
+   * @param disk_manager the disk manager the log is written through
+   */
+  explicit LogManager(DiskManager *disk_manager);
+
+  DISALLOW_COPY_AND_MOVE(LogManager);
+
+  /**
+   * @brief Stop the flush thread (flushing what is left) and destroy the LogManager.
+   */
+  ~LogManager();
+
+  /** @brief Start the background flush thread. */
+  void RunFlushThread();
+
+  /** @brief Flush everything that was appended and stop the background flush thread. */
+  void StopFlushThread();
+
+  /**
+   * @brief Append a log record to the log buffer.
+   *
+   * Blocks only if both buffers are full, until the flush thread frees one.
+   *
+   * @param record payload of the record
+   * @param size size of the payload, the header must fit into one log buffer along with it
+   * @return the LSN assigned to the record
+   */
+  auto AppendLogRecord(const char *record, size_t size) -> lsn_t;
+
+  /**
+   * @brief Block until every record up to and including `lsn` is durable on disk.
+   *
+   * Wakes up the flush thread if needed. LSNs that were never handed out are clamped to the last appended record.
+   * If the flush thread is not running, the caller flushes the log itself.
+   *
+   * @param lsn the LSN that has to be durable
+   */
+  void WaitForDurable(lsn_t lsn);
+
+  /**
+   * @brief Check, without blocking, whether every record up to and including `lsn` is durable, with the same
+   * clamping as WaitForDurable.
+   * @param lsn the LSN that has to be durable
+   * @return true if WaitForDurable(lsn) would not wait
+   */
+  auto IsDurable(lsn_t lsn) -> bool { return persistent_lsn_ >= std::min<lsn_t>(lsn, next_lsn_ - 1); }
+
+  /** @return the LSN the next appended record will get */
+  auto GetNextLSN() -> lsn_t { return next_lsn_; }
+
+  /** @return the largest LSN known to be durable, INVALID_LSN if none is */
+  auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
+
+  /** @return the number of log flushes performed, each serving one group of commits */
+  auto GetNumFlushes() -> size_t { return num_flushes_; }
+
+  /** Header stored in front of every record payload. */
+  struct RecordHeader {
+    /** Size of the record including this header. */
+    uint32_t size_;
+    lsn_t lsn_;
+  };
+
+ private:
+  /**
+   * @brief Swap the buffers and write out the one that was filled. Called with the latch held through `lock`,
+   * releases it during the write. Only one flush runs at a time.
+   */
+  void FlushBuffer(std::unique_lock<std::mutex> *lock);
+
+  /** @brief Body of the background flush thread. */
+  void FlushThreadLoop();
+
+  DiskManager *disk_manager_;
+  /** Buffer records are appended to. */
+  std::unique_ptr<char[]> log_buffer_;
+  /** Buffer being written out by the flush in progress. */
+  std::unique_ptr<char[]> flush_buffer_;
+  /** Number of bytes used in log_buffer_. */
+  size_t log_buffer_offset_{0};
+  /** LSN of the last record in log_buffer_. */
+  lsn_t last_buffered_lsn_{INVALID_LSN};
+
+  std::atomic<lsn_t> next_lsn_{0};
+  std::atomic<lsn_t> persistent_lsn_{INVALID_LSN};
+  std::atomic<size_t> num_flushes_{0};
+
+  bool flush_requested_{false};
+  bool flush_in_progress_{false};
+  bool stop_{false};
+  std::unique_ptr<std::thread> flush_thread_;
+
+  /** Protects the buffers and the flags above. */
+  std::mutex latch_;
+  /** Wakes up the flush thread. */
+  std::condition_variable flush_cv_;
+  /** Signaled after every flush, for committers waiting for durability and appenders waiting for space. */
+  std::condition_variable durable_cv_;
+};
@@ -1,45 +1,180 @@
 #include "lru_k_replacer.h"
 
-LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
+#include <algorithm>
 
-auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
-  std::scoped_lock scoped_lock(latch_);
-  // No available evictable frame
-  if (curr_size_ == 0) {
-    return false;
-  }
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k, size_t dirty_skip_limit)
+    : replacer_size_(num_frames), k_(k), dirty_skip_limit_(std::min(dirty_skip_limit, LRUK_REPLACER_MAX_DIRTY_SKIP)) {}
+
+auto LRUKReplacer::EvictionRank(const LRUKNode &node) const -> std::pair<bool, size_t> {
+  // The size of history is not k_, which means +inf backward-k distance, and those always go first.
+  // In both groups the least recent front timestamp is the largest distance (or plain LRU for +inf).
+  // A node whose history was cleared by a previous eviction is treated as the oldest possible one.
+  return {node.history_.size() == k_, node.history_.empty() ? 0 : node.history_.front()};
+}
 
-  size_t max_difference = 0;
-  bool flag = true;
-  // Set to the max value of potential size_t type
-  size_t least_recent_vis_stamp = SIZE_MAX;
+template <class Predicate>
+auto LRUKReplacer::PickVictimAmong(frame_id_t *frame_id, bool *skipped_dirty, Predicate &&is_candidate) -> bool {
+  struct Candidate {
+    std::pair<bool, size_t> rank_;
+    frame_id_t frame_id_;
+    bool is_dirty_;
+  };
+  // The candidates closest to the eviction end, best first. Evict runs on every miss, so no allocation and no sort.
+  std::array<Candidate, LRUK_REPLACER_MAX_DIRTY_SKIP + 1> window;
+  size_t capacity = dirty_skip_limit_ + 1;
+  size_t size = 0;
   for (auto &[id, node] : node_store_) {
-    if (!node.is_evictable_) {
+    if (!is_candidate(node)) {
       continue;
     }
-    // The size of history is not k_, which means +inf backward-k distance
-    if (node.history_.size() != k_) {
-      flag = false;  // Represent there is node with +inf record, no need to record k one then
-      if (least_recent_vis_stamp > node.history_.front()) {
-        least_recent_vis_stamp = node.history_.front();
-        *frame_id = id;
-      }
+    Candidate candidate{EvictionRank(node), id, node.is_dirty_};
+    if (size == capacity && !(candidate.rank_ < window[size - 1].rank_)) {
       continue;
     }
-    // Else do the normal thing
-    if (flag && (current_timestamp_ - node.history_.front()) > max_difference) {
-      max_difference = current_timestamp_ - node.history_.front();
-      *frame_id = id;
+    // Insert in order, pushing out the last candidate if the window is full
+    size_t i = size < capacity ? size++ : size - 1;
+    for (; i > 0 && candidate.rank_ < window[i - 1].rank_; --i) {
+      window[i] = window[i - 1];
     }
+    window[i] = candidate;
+  }
+  if (size == 0) {
+    return false;
+  }
+
+  // Take the first clean one, or the best if they are all dirty
+  *frame_id = window[0].frame_id_;
+  for (size_t i = 0; i < size; ++i) {
+    if (!window[i].is_dirty_) {
+      *skipped_dirty = i != 0;
+      *frame_id = window[i].frame_id_;
+      break;
+    }
+  }
+  return true;
+}
+
+auto LRUKReplacer::CanGiveUpFrame(const LRUKNode &node, tenant_id_t tenant) const -> bool {
+  if (node.tenant_ == tenant) {
+    return true;
+  }
+  auto owner = tenants_.find(node.tenant_);
+  return owner == tenants_.end() || owner->second.frames_ > owner->second.min_frames_;
+}
+
+auto LRUKReplacer::PickVictim(frame_id_t *frame_id, bool probation_only, tenant_id_t tenant, bool *skipped_dirty)
+    -> bool {
+  *skipped_dirty = false;
+  // A tenant that reached its maximum may only replace its own frames, others may take any frame whose owner
+  // stays at or above its reserved minimum afterwards
+  bool at_quota = !CanGrowUnlocked(tenant);
+  auto allowed = [&](const LRUKNode &node) {
+    if (!node.is_evictable_ || (probation_only && !node.is_probation_)) {
+      return false;
+    }
+    if (!has_quotas_) {
+      return true;
+    }
+    return at_quota ? node.tenant_ == tenant : CanGiveUpFrame(node, tenant);
+  };
+
+  // Probation frames are only handed out as ordinary victims when nothing else is evictable
+  bool skip_probation = !probation_only && probation_evictable_ > 0;
+  for (;;) {
+    if (PickVictimAmong(frame_id, skipped_dirty, [&](const LRUKNode &node) {
+          return allowed(node) && !(skip_probation && node.is_probation_);
+        })) {
+      return true;
+    }
+    if (!skip_probation) {
+      return false;
+    }
+    skip_probation = false;
+  }
+}
+
+auto LRUKReplacer::EvictUnlocked(frame_id_t *frame_id, bool probation_only, tenant_id_t tenant) -> bool {
+  // No available evictable frame
+  if (curr_size_ == 0) {
+    return false;
   }
+  bool skipped_dirty;
+  if (!PickVictim(frame_id, probation_only, tenant, &skipped_dirty)) {
+    return false;
+  }
+
   // Update relevant status
-  node_store_[*frame_id].is_evictable_ = false;
-  node_store_[*frame_id].history_.clear();
+  LRUKNode &node = node_store_[*frame_id];
+  if (skipped_dirty) {
+    dirty_evictions_avoided_ += 1;
+  }
+  if (node.is_dirty_) {
+    dirty_evictions_ += 1;
+  }
+  if (node.is_probation_) {
+    probation_evictable_ -= 1;
+    probation_size_ -= 1;
+  }
+  node.is_evictable_ = false;
+  node.is_dirty_ = false;
+  node.is_probation_ = false;
+  node.history_.clear();
+  ReleaseOwnership(&node);
   curr_size_ -= 1;
 
   return true;
 }
 
+auto LRUKReplacer::Evict(frame_id_t *frame_id, tenant_id_t tenant) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  return EvictUnlocked(frame_id, false, tenant);
+}
+
+auto LRUKReplacer::EvictProbation(frame_id_t *frame_id, tenant_id_t tenant) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  return EvictUnlocked(frame_id, true, tenant);
+}
+
+auto LRUKReplacer::PeekVictim(frame_id_t *frame_id, tenant_id_t tenant, bool probation_only) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  if (curr_size_ == 0) {
+    return false;
+  }
+  bool skipped_dirty;
+  return PickVictim(frame_id, probation_only, tenant, &skipped_dirty);
+}
+
+auto LRUKReplacer::PeekVictims(size_t max_victims, tenant_id_t tenant) -> std::vector<frame_id_t> {
+  std::scoped_lock scoped_lock(latch_);
+  bool at_quota = !CanGrowUnlocked(tenant);
+  std::vector<std::pair<std::pair<bool, std::pair<bool, size_t>>, frame_id_t>> candidates;
+  for (auto &[id, node] : node_store_) {
+    if (node.is_evictable_ && (!has_quotas_ || !at_quota || node.tenant_ == tenant)) {
+      candidates.emplace_back(std::make_pair(node.is_probation_, EvictionRank(node)), id);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  std::vector<frame_id_t> victims;
+  // Frames already listed per owner, which the owner's reserve has to cover as well
+  std::unordered_map<tenant_id_t, size_t> taken;
+  for (auto &[rank, id] : candidates) {
+    if (victims.size() == max_victims) {
+      break;
+    }
+    const LRUKNode &node = node_store_[id];
+    if (has_quotas_ && node.is_owned_ && node.tenant_ != tenant) {
+      auto owner = tenants_.find(node.tenant_);
+      if (owner != tenants_.end() && owner->second.frames_ <= owner->second.min_frames_ + taken[node.tenant_]) {
+        continue;
+      }
+      taken[node.tenant_] += 1;
+    }
+    victims.push_back(id);
+  }
+  return victims;
+}
+
 void LRUKReplacer::RecordAccess(frame_id_t frame_id, [[maybe_unused]] AccessType access_type) {
   std::scoped_lock scoped_lock(latch_);
 
@@ -75,6 +210,9 @@ void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
   } else {
     return;
   }
+  if (tmp_node.is_probation_) {
+    probation_evictable_ = set_evictable ? probation_evictable_ + 1 : probation_evictable_ - 1;
+  }
 
   node_store_[frame_id].is_evictable_ = set_evictable;
 }
@@ -91,10 +229,108 @@ void LRUKReplacer::Remove(frame_id_t frame_id) {
     return;
   }
 
+  if (node_store_[frame_id].is_probation_) {
+    probation_evictable_ -= 1;
+    probation_size_ -= 1;
+  }
   node_store_[frame_id].history_.clear();
   node_store_[frame_id].is_evictable_ = false;
+  node_store_[frame_id].is_dirty_ = false;
+  node_store_[frame_id].is_probation_ = false;
+  ReleaseOwnership(&node_store_[frame_id]);
   curr_size_ -= 1;
 }
 
+void LRUKReplacer::SetDirty(frame_id_t frame_id, bool is_dirty) {
+  std::scoped_lock scoped_lock(latch_);
+
+  auto it = node_store_.find(frame_id);
+  if (it == node_store_.end()) {
+    return;
+  }
+  it->second.is_dirty_ = is_dirty;
+}
+
+void LRUKReplacer::SetProbation(frame_id_t frame_id, bool is_probation) {
+  std::scoped_lock scoped_lock(latch_);
+
+  auto it = node_store_.find(frame_id);
+  if (it == node_store_.end() || it->second.is_probation_ == is_probation) {
+    return;
+  }
+  it->second.is_probation_ = is_probation;
+  probation_size_ = is_probation ? probation_size_ + 1 : probation_size_ - 1;
+  if (it->second.is_evictable_) {
+    probation_evictable_ = is_probation ? probation_evictable_ + 1 : probation_evictable_ - 1;
+  }
+}
+
+auto LRUKReplacer::IsProbation(frame_id_t frame_id) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+
+  auto it = node_store_.find(frame_id);
+  return it != node_store_.end() && it->second.is_probation_;
+}
+
+auto LRUKReplacer::ProbationSize() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return probation_size_;
+}
+
+void LRUKReplacer::SetTenant(frame_id_t frame_id, tenant_id_t tenant) {
+  std::scoped_lock scoped_lock(latch_);
+
+  auto it = node_store_.find(frame_id);
+  if (it == node_store_.end()) {
+    throw bustub::NotImplementedException("Invalid frame_id for SetTenant");
+  }
+  ReleaseOwnership(&it->second);
+  it->second.tenant_ = tenant;
+  it->second.is_owned_ = true;
+  tenants_[tenant].frames_ += 1;
+}
+
+void LRUKReplacer::SetTenantQuota(tenant_id_t tenant, size_t min_frames, size_t max_frames) {
+  std::scoped_lock scoped_lock(latch_);
+  TenantQuota &quota = tenants_[tenant];
+  quota.min_frames_ = min_frames;
+  quota.max_frames_ = max_frames;
+  has_quotas_ = true;
+}
+
+auto LRUKReplacer::CanGrow(tenant_id_t tenant) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  return CanGrowUnlocked(tenant);
+}
+
+auto LRUKReplacer::GetTenantFrames(tenant_id_t tenant) -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  auto it = tenants_.find(tenant);
+  return it == tenants_.end() ? 0 : it->second.frames_;
+}
+
+auto LRUKReplacer::CanGrowUnlocked(tenant_id_t tenant) const -> bool {
+  auto it = tenants_.find(tenant);
+  return it == tenants_.end() || it->second.frames_ < it->second.max_frames_;
+}
+
+void LRUKReplacer::ReleaseOwnership(LRUKNode *node) {
+  if (!node->is_owned_) {
+    return;
+  }
+  node->is_owned_ = false;
+  tenants_[node->tenant_].frames_ -= 1;
+}
+
 auto LRUKReplacer::Size() -> size_t { return curr_size_; }
 
+auto LRUKReplacer::GetDirtyEvictionsAvoided() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return dirty_evictions_avoided_;
+}
+
+auto LRUKReplacer::GetDirtyEvictions() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return dirty_evictions_;
+}
+
@@ -1,13 +1,28 @@
 #pragma once
 
+#include <array>
 #include <limits>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "lock_profiler.h"
+
 enum class AccessType { Unknown = 0, Get, Scan };
 
+/** Identifies the tenant (or any other caller class) a buffer pool frame is charged to. */
+using tenant_id_t = int32_t;
+static constexpr tenant_id_t DEFAULT_TENANT = 0;
+/** Stands for a caller that frees frames without taking them, e.g. to refill the buffer pool's free list. */
+static constexpr tenant_id_t NO_TENANT = -1;
+
+/** Default number of dirty candidates the buffer pool lets the replacer skip in favor of a clean victim. */
+static constexpr size_t LRUK_REPLACER_DIRTY_SKIP = 4;
+/** Largest dirty skip limit, which bounds the candidate window Evict keeps on the stack. */
+static constexpr size_t LRUK_REPLACER_MAX_DIRTY_SKIP = 15;
+
 class LRUKReplacer;
 class LRUKNode {
   friend class LRUKReplacer;
@@ -20,6 +35,20 @@ class LRUKNode {
   [[maybe_unused]] size_t k_;
   [[maybe_unused]] frame_id_t fid_;
   bool is_evictable_{false};
+  /** Hint from the buffer pool: evicting this frame costs a synchronous write. */
+  bool is_dirty_{false};
+  /** True if the frame sits in the admission window, i.e. its page has not been admitted to the main area yet. */
+  bool is_probation_{false};
+  /** Tenant the frame is charged to, only meaningful while is_owned_ is set. */
+  tenant_id_t tenant_{DEFAULT_TENANT};
+  bool is_owned_{false};
+};
+
+/** Frame quota and current usage of one tenant. */
+struct TenantQuota {
+  size_t min_frames_{0};
+  size_t max_frames_{std::numeric_limits<size_t>::max()};
+  size_t frames_{0};
 };
 
 /**
@@ -32,6 +61,18 @@ class LRUKNode {
  * A frame with less than k historical references is given
  * +inf as its backward k-distance. When multipe frames have +inf backward k-distance,
  * classical LRU algorithm is used to choose victim.
+ *
+ * The replacer is also cost-aware: the buffer pool passes dirty/clean hints through SetDirty, and Evict may
+ * skip up to `dirty_skip_limit` dirty frames at the eviction end in favor of the next clean one, since
+ * evicting a dirty frame makes the pool write it out before the frame can be reused.
+ *
+ * Frames can further be marked as probation frames, which form the small admission window used by the
+ * buffer pool's TinyLFU filter. Probation frames are recycled among themselves through EvictProbation and
+ * are only returned by Evict when no other frame is evictable.
+ *
+ * Finally, every frame can be charged to a tenant through SetTenant. With SetTenantQuota a tenant gets a number of
+ * reserved frames that other tenants can't take away from it, and a maximum beyond which it can only replace
+ * its own frames.
  */
 class LRUKReplacer {
  public:
@@ -39,8 +80,10 @@ class LRUKReplacer {
    *
    * @brief a new LRUKReplacer.
    * @param num_frames the maximum number of frames the LRUReplacer will be required to store
+   * @param dirty_skip_limit how many dirty candidates Evict may pass over to find a clean victim (0 = plain LRU-K),
+   * at most LRUK_REPLACER_MAX_DIRTY_SKIP
    */
-  explicit LRUKReplacer(size_t num_frames, size_t k);
+  explicit LRUKReplacer(size_t num_frames, size_t k, size_t dirty_skip_limit = 0);
 
   DISALLOW_COPY_AND_MOVE(LRUKReplacer);
 
@@ -62,10 +105,47 @@ class LRUKReplacer {
    * Successful eviction of a frame should decrement the size of replacer and remove the frame's
    * access history.
    *
+   * If dirty_skip_limit is non-zero, the first clean frame among the `dirty_skip_limit + 1` best candidates
+   * is evicted instead, so that a dirty frame is only chosen when no cheap victim is close to the eviction end.
+   *
+   * If tenant quotas are set, only frames that `tenant` may take are candidates: its own frames once it reached its
+   * maximum, otherwise any frame whose owner stays at or above its reserved minimum.
+   *
    * @param[out] frame_id id of frame that is evicted.
+   * @param tenant the tenant the freed frame is going to be charged to
    * @return true if a frame is evicted successfully, false if no frames can be evicted.
    */
-  auto Evict(frame_id_t *frame_id) -> bool;
+  auto Evict(frame_id_t *frame_id, tenant_id_t tenant = DEFAULT_TENANT) -> bool;
+
+  /**
+   * @brief Same as Evict, but only probation frames are candidates.
+   * @param[out] frame_id id of frame that is evicted.
+   * @param tenant the tenant the freed frame is going to be charged to
+   * @return true if a probation frame is evicted successfully, false otherwise.
+   */
+  auto EvictProbation(frame_id_t *frame_id, tenant_id_t tenant = DEFAULT_TENANT) -> bool;
+
+  /**
+   * @brief Return the frame Evict, or EvictProbation, would choose right now, without evicting it.
+   * @param[out] frame_id id of the would-be victim.
+   * @param tenant the tenant the freed frame would be charged to
+   * @param probation_only only consider probation frames, like EvictProbation
+   * @return true if there is a victim, false if no frames can be evicted.
+   */
+  auto PeekVictim(frame_id_t *frame_id, tenant_id_t tenant = DEFAULT_TENANT, bool probation_only = false) -> bool;
+
+  /**
+   * @brief List the frames successive evictions would take, best victim first, without changing any state.
+   *
+   * Candidates are ranked by backward k-distance alone, dirty or not, with probation frames after all others.
+   * Quotas apply to the list as a whole: it never holds so many frames of one tenant that evicting all of them
+   * would leave the tenant below its reserved minimum.
+   *
+   * @param max_victims most frames to return
+   * @param tenant the tenant the freed frames would be charged to, NO_TENANT if they are not going to be
+   * @return the frames, in eviction order
+   */
+  auto PeekVictims(size_t max_victims, tenant_id_t tenant = NO_TENANT) -> std::vector<frame_id_t>;
 
   /**
    * @brief Record the event that the given frame id is accessed at current timestamp.
@@ -97,6 +177,57 @@ class LRUKReplacer {
    */
   void SetEvictable(frame_id_t frame_id, bool set_evictable);
 
+  /**
+   * @brief Tell the replacer whether evicting the given frame would require a write back.
+   *
+   * This is only a hint used to rank victims, it never changes the replacer's size.
+   * If frame id is unknown to the replacer, the hint is ignored.
+   *
+   * @param frame_id id of frame whose dirty status changed
+   * @param is_dirty whether the frame is currently dirty
+   */
+  void SetDirty(frame_id_t frame_id, bool is_dirty);
+
+  /**
+   * @brief Move a frame in or out of the probation (admission window) area.
+   *
+   * The flag is cleared on eviction and removal. If frame id is unknown to the replacer, the call is ignored.
+   *
+   * @param frame_id id of frame to move
+   * @param is_probation whether the frame belongs to the probation area
+   */
+  void SetProbation(frame_id_t frame_id, bool is_probation);
+
+  /** @return true if the frame is currently in the probation area */
+  auto IsProbation(frame_id_t frame_id) -> bool;
+
+  /** @return the number of frames in the probation area, evictable or not */
+  auto ProbationSize() -> size_t;
+
+  /**
+   * @brief Charge a frame to a tenant. The frame stays charged until it is evicted or removed.
+   *
+   * If frame id is invalid, throw an exception or abort the process.
+   *
+   * @param frame_id id of frame that now holds a page of the tenant
+   * @param tenant the owning tenant
+   */
+  void SetTenant(frame_id_t frame_id, tenant_id_t tenant);
+
+  /**
+   * @brief Set the frame quota of a tenant. Tenants without a quota are unrestricted.
+   * @param tenant the tenant
+   * @param min_frames number of frames other tenants can't evict from this tenant
+   * @param max_frames number of frames beyond which this tenant can only replace its own frames
+   */
+  void SetTenantQuota(tenant_id_t tenant, size_t min_frames, size_t max_frames);
+
+  /** @return true if the tenant may be charged one more frame without replacing one of its own */
+  auto CanGrow(tenant_id_t tenant) -> bool;
+
+  /** @return the number of frames currently charged to the tenant */
+  auto GetTenantFrames(tenant_id_t tenant) -> size_t;
+
   /**
    * @brief Remove an evictable frame from replacer, along with its access history.
    * This function should also decrement replacer's size if removal is successful.
@@ -121,11 +252,60 @@ class LRUKReplacer {
    */
   auto Size() -> size_t;
 
+  /** @return the number of times Evict chose a clean frame over a dirty frame ranked ahead of it */
+  auto GetDirtyEvictionsAvoided() -> size_t;
+
+  /** @return the number of times Evict had to hand out a dirty frame */
+  auto GetDirtyEvictions() -> size_t;
+
  private:
+  /**
+   * @brief Eviction rank of a node, smaller is evicted first.
+   *
+   * Frames with +inf backward k-distance come before all others, and within each group the
+   * frame with the earliest relevant timestamp goes first.
+   */
+  auto EvictionRank(const LRUKNode &node) const -> std::pair<bool, size_t>;
+
+  /**
+   * @brief Choose a victim without touching any state. Caller should hold the latch.
+   * @param[out] frame_id the chosen frame
+   * @param probation_only only consider probation frames
+   * @param[out] skipped_dirty set if a dirty frame ranked ahead of the chosen one was passed over
+   * @return false if there is no candidate
+   */
+  auto PickVictim(frame_id_t *frame_id, bool probation_only, tenant_id_t tenant, bool *skipped_dirty) -> bool;
+
+  /**
+   * @brief Pick the best victim among the nodes accepted by the predicate, in one pass that keeps the
+   * dirty_skip_limit_ + 1 best candidates in a fixed array. Caller should hold the latch.
+   */
+  template <class Predicate>
+  auto PickVictimAmong(frame_id_t *frame_id, bool *skipped_dirty, Predicate &&is_candidate) -> bool;
+
+  /** @brief Evict implementation shared by Evict and EvictProbation. Caller should hold the latch. */
+  auto EvictUnlocked(frame_id_t *frame_id, bool probation_only, tenant_id_t tenant) -> bool;
+
+  /** @return true if taking the node's frame away leaves its owner at or above its reserved minimum */
+  auto CanGiveUpFrame(const LRUKNode &node, tenant_id_t tenant) const -> bool;
+
+  /** @brief CanGrow without the latch. */
+  auto CanGrowUnlocked(tenant_id_t tenant) const -> bool;
+
+  /** @brief Stop charging the node's frame to its tenant, if it is charged to one. */
+  void ReleaseOwnership(LRUKNode *node);
+
   std::unordered_map<frame_id_t, LRUKNode> node_store_;
   size_t current_timestamp_{0};
   size_t curr_size_{0};
   size_t replacer_size_;
   size_t k_;
-  std::mutex latch_;
+  size_t dirty_skip_limit_;
+  size_t dirty_evictions_avoided_{0};
+  size_t dirty_evictions_{0};
+  size_t probation_size_{0};
+  size_t probation_evictable_{0};
+  std::unordered_map<tenant_id_t, TenantQuota> tenants_;
+  bool has_quotas_{false};
+  ProfiledMutex<LockSite::Replacer> latch_;
 };
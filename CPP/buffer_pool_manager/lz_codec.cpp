@@ -0,0 +1,155 @@
+#include "lz_codec.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr size_t HASH_BITS = 12;
+constexpr uint32_t NO_POSITION = UINT32_MAX;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr uint8_t NIBBLE_MAX = 15;
+
+inline auto Read32(const char *p) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline auto Hash(uint32_t sequence) -> size_t { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Writes the continuation bytes of a length whose nibble saturated. Returns false on overflow. */
+inline auto WriteLength(size_t length, char *dst, size_t capacity, size_t *op) -> bool {
+  while (length >= 255) {
+    if (*op >= capacity) {
+      return false;
+    }
+    dst[(*op)++] = static_cast<char>(255);
+    length -= 255;
+  }
+  if (*op >= capacity) {
+    return false;
+  }
+  dst[(*op)++] = static_cast<char>(length);
+  return true;
+}
+
+/** Reads the continuation bytes of a length whose nibble saturated. Returns false on truncated input. */
+inline auto ReadLength(const char *src, size_t size, size_t *ip, size_t *length) -> bool {
+  uint8_t byte;
+  do {
+    if (*ip >= size) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(src[(*ip)++]);
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/** Emits one sequence, `match_length` 0 means a final literal-only sequence. Returns false on overflow. */
+auto EmitSequence(const char *literals, size_t literal_length, size_t offset, size_t match_length, char *dst,
+                  size_t capacity, size_t *op) -> bool {
+  if (*op >= capacity) {
+    return false;
+  }
+  size_t match_code = match_length == 0 ? 0 : match_length - LZCodec::MIN_MATCH;
+  size_t token_pos = (*op)++;
+  dst[token_pos] = static_cast<char>(((literal_length < NIBBLE_MAX ? literal_length : NIBBLE_MAX) << 4) |
+                                     (match_code < NIBBLE_MAX ? match_code : NIBBLE_MAX));
+  if (literal_length >= NIBBLE_MAX && !WriteLength(literal_length - NIBBLE_MAX, dst, capacity, op)) {
+    return false;
+  }
+  if (*op + literal_length > capacity) {
+    return false;
+  }
+  memcpy(dst + *op, literals, literal_length);
+  *op += literal_length;
+  if (match_length == 0) {
+    return true;
+  }
+  if (*op + 2 > capacity) {
+    return false;
+  }
+  dst[(*op)++] = static_cast<char>(offset & 0xFF);
+  dst[(*op)++] = static_cast<char>(offset >> 8);
+  return match_code < NIBBLE_MAX || WriteLength(match_code - NIBBLE_MAX, dst, capacity, op);
+}
+
+}  // namespace
+
+auto LZCodec::Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t {
+  std::array<uint32_t, 1 << HASH_BITS> table;
+  table.fill(NO_POSITION);
+
+  size_t op = 0;
+  size_t anchor = 0;
+  size_t ip = 0;
+  while (ip + MIN_MATCH <= size) {
+    uint32_t sequence = Read32(src + ip);
+    size_t slot = Hash(sequence);
+    uint32_t ref = table[slot];
+    table[slot] = static_cast<uint32_t>(ip);
+    if (ref == NO_POSITION || ip - ref > MAX_OFFSET || Read32(src + ref) != sequence) {
+      ip += 1;
+      continue;
+    }
+    // Extend the match as far as it goes, it may overlap the current position
+    size_t match_length = MIN_MATCH;
+    while (ip + match_length < size && src[ref + match_length] == src[ip + match_length]) {
+      match_length += 1;
+    }
+    if (!EmitSequence(src + anchor, ip - anchor, ip - ref, match_length, dst, capacity, &op)) {
+      return 0;
+    }
+    ip += match_length;
+    anchor = ip;
+  }
+  if (!EmitSequence(src + anchor, size - anchor, 0, 0, dst, capacity, &op)) {
+    return 0;
+  }
+  return op;
+}
+
+auto LZCodec::Decompress(const char *src, size_t size, char *dst, size_t original_size) -> bool {
+  size_t ip = 0;
+  size_t op = 0;
+  while (ip < size) {
+    auto token = static_cast<uint8_t>(src[ip++]);
+    size_t literal_length = token >> 4;
+    if (literal_length == NIBBLE_MAX && !ReadLength(src, size, &ip, &literal_length)) {
+      return false;
+    }
+    if (ip + literal_length > size || op + literal_length > original_size) {
+      return false;
+    }
+    memcpy(dst + op, src + ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == size) {
+      // Literal-only sequence, end of block
+      break;
+    }
+
+    if (ip + 2 > size) {
+      return false;
+    }
+    size_t offset = static_cast<uint8_t>(src[ip]) | (static_cast<size_t>(static_cast<uint8_t>(src[ip + 1])) << 8);
+    ip += 2;
+    size_t match_length = token & NIBBLE_MAX;
+    if (match_length == NIBBLE_MAX && !ReadLength(src, size, &ip, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > op || op + match_length > original_size) {
+      return false;
+    }
+    // Byte by byte, since the match may overlap the bytes it produces
+    const char *match = dst + op - offset;
+    for (size_t i = 0; i < match_length; ++i) {
+      dst[op + i] = match[i];
+    }
+    op += match_length;
+  }
+  return op == original_size;
+}
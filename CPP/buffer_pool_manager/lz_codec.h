@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LZCodec is a small, dependency-free LZ77 codec in the spirit of LZ4, tuned for compressing single pages.
+ *
+ * A compressed block is a series of sequences. Each sequence starts with a token byte whose high nibble is the
+ * number of literals and whose low nibble is the match length minus MIN_MATCH; a nibble of 15 means the length
+ * continues in the following bytes (each 255 adds 255, the first byte below 255 terminates it). The literals follow,
+ * then a 2-byte little-endian offset back into the already decoded output and the match length continuation. The
+ * last sequence consists of literals only and ends the block.
+ *
+ * Compression is greedy with a single hash probe per position, which keeps it in the GB/s range while still
+ * collapsing the zero-filled and repetitive regions typical of database pages.
+ */
+class LZCodec {
+ public:
+  /** Shortest match the encoder emits. */
+  static constexpr size_t MIN_MATCH = 4;
+
+  /** @return the worst-case compressed size of `size` input bytes */
+  static constexpr auto MaxCompressedSize(size_t size) -> size_t { return size + size / 255 + 16; }
+
+  /**
+   * @brief Compress a buffer.
+   * @param src input data
+   * @param size number of input bytes
+   * @param[out] dst output buffer
+   * @param capacity size of the output buffer
+   * @return the compressed size, or 0 if the result would not fit in `capacity` bytes
+   */
+  static auto Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t;
+
+  /**
+   * @brief Decompress a buffer produced by Compress.
+   * @param src compressed data
+   * @param size number of compressed bytes
+   * @param[out] dst output buffer
+   * @param original_size exact number of bytes the data decompresses to
+   * @return false if the input is corrupted or does not decompress to exactly `original_size` bytes
+   */
+  static auto Decompress(const char *src, size_t size, char *dst, size_t original_size) -> bool;
+};
@@ -1,7 +1,28 @@
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <vector>
+
+#include "dirty_range_set.h"
+#include "lock_profiler.h"
+#include "page_latch.h"
+#include "zero_fill.h"
+
+/**
+ * Page size classes, each four times the size of the one before: 4, 16, 64 and 256 KiB with the default 4 KiB
+ * BUSTUB_PAGE_SIZE. A page of a larger class spans consecutive page ids on disk, one per BUSTUB_PAGE_SIZE block,
+ * and is identified by the first of them.
+ */
+enum class PageSizeClass { Size4K = 0, Size16K, Size64K, Size256K };
+
+static constexpr size_t NUM_PAGE_SIZE_CLASSES = 4;
+
+/** @return the number of BUSTUB_PAGE_SIZE blocks, and of page ids, a page of the size class spans */
+inline constexpr auto PagesInClass(PageSizeClass size_class) -> size_t {
+  return size_t{1} << (2 * static_cast<size_t>(size_class));
+}
 
 /**
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
@@ -11,6 +32,7 @@
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
+  friend class ChecksumDiskManager;
 
  public:
   /** Constructor. Zeros out the page data. */
@@ -25,6 +47,12 @@ class Page {
   /** @return the actual data contained within this page */
   inline auto GetData() -> char * { return data_; }
 
+  /** @return the size class of this page */
+  inline auto GetSizeClass() -> PageSizeClass { return size_class_; }
+
+  /** @return the size of this page's data in bytes */
+  inline auto GetSize() -> size_t { return BUSTUB_PAGE_SIZE * PagesInClass(size_class_); }
+
   /** @return the page id of this page */
   inline auto GetPageId() -> page_id_t { return page_id_; }
 
@@ -34,18 +62,80 @@ class Page {
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline auto IsDirty() -> bool { return is_dirty_; }
 
+  /** @return true if the page is permanently resident in the buffer pool */
+  inline auto IsResident() -> bool { return is_resident_; }
+
+#ifdef BUSTUB_LOCK_PROFILING
+  // Page latches are shared, so their holds are timed by the profiler rather than in the latch
+  inline void WLatch() {
+    if (!rwlatch_.TryWLock()) {
+      uint64_t start = LockProfiler::Now();
+      rwlatch_.WLock();
+      LockProfiler::RecordAcquire(LockSite::Page, true, LockProfiler::Now() - start);
+    } else {
+      LockProfiler::RecordAcquire(LockSite::Page, false, 0);
+    }
+    LockProfiler::BeginHold(&rwlatch_);
+  }
+
+  inline void WUnlatch() {
+    LockProfiler::EndHold(LockSite::Page, &rwlatch_);
+    rwlatch_.WUnlock();
+  }
+
+  inline void RLatch() {
+    if (!rwlatch_.TryRLock()) {
+      uint64_t start = LockProfiler::Now();
+      rwlatch_.RLock();
+      LockProfiler::RecordAcquire(LockSite::Page, true, LockProfiler::Now() - start);
+    } else {
+      LockProfiler::RecordAcquire(LockSite::Page, false, 0);
+    }
+    LockProfiler::BeginHold(&rwlatch_);
+  }
+
+  inline void RUnlatch() {
+    LockProfiler::EndHold(LockSite::Page, &rwlatch_);
+    rwlatch_.RUnlock();
+  }
+
+  // A mode switch keeps the hold going, only the wait of a blocking upgrade is recorded
+  inline auto TryUpgradeLatch() -> bool { return rwlatch_.TryUpgrade(); }
+
+  inline auto UpgradeLatch() -> bool {
+    if (rwlatch_.TryUpgrade()) {
+      return true;
+    }
+    uint64_t start = LockProfiler::Now();
+    bool held = rwlatch_.Upgrade();
+    LockProfiler::RecordAcquire(LockSite::Page, true, LockProfiler::Now() - start);
+    return held;
+  }
+
+  inline void DowngradeLatch() { rwlatch_.Downgrade(); }
+#else
   /** Acquire the page write latch. */
   inline void WLatch() { rwlatch_.WLock(); }
 
   /** Release the page write latch. */
   inline void WUnlatch() { rwlatch_.WUnlock(); }
 
-  /** Acquire the page read latch. */
+  /** Acquire the page read latch. Not reentrant: see PageLatch on read-latching a page twice. */
   inline void RLatch() { rwlatch_.RLock(); }
 
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /** Upgrade the page read latch to the write latch if no one else holds it. @return true on success */
+  inline auto TryUpgradeLatch() -> bool { return rwlatch_.TryUpgrade(); }
+
+  /** Upgrade the page read latch to the write latch. @return false if the latch was released in between */
+  inline auto UpgradeLatch() -> bool { return rwlatch_.Upgrade(); }
+
+  /** Downgrade the page write latch to a read latch. */
+  inline void DowngradeLatch() { rwlatch_.Downgrade(); }
+#endif
+
   /** @return the page LSN. */
   inline auto GetLSN() -> lsn_t { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -58,22 +148,69 @@ class Page {
 
   static constexpr size_t SIZE_PAGE_HEADER = 8;
   static constexpr size_t OFFSET_PAGE_START = 0;
+  /**
+   * The first four header bytes are reserved: they hold the page's CRC-32C while it is on disk, see
+   * ChecksumDiskManager, and read back as zeroes. Page layouts must not store data there.
+   */
+  static constexpr size_t OFFSET_CHECKSUM = 0;
   static constexpr size_t OFFSET_LSN = 4;
 
  private:
   /** Zeroes out the data that is held within the page. */
-  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, GetSize()); }
+
+  /** Zeroes out the data that is held within the page, bypassing the cache. */
+  inline void ResetMemoryStreaming() { ZeroFill::Streaming(data_, GetSize()); }
+
+  /** @return the bytes of memory the frame's buffer takes, 0 if it has none */
+  inline auto MemorySize() -> size_t { return data_ == nullptr ? 0 : GetSize(); }
+
+  /** Frees the buffer, the frame holds no page until AllocateMemory gives it a new one. */
+  inline void ReleaseMemory() {
+    delete[] data_;
+    data_ = nullptr;
+  }
+
+  /** Gives a frame without a buffer one of the given size class. */
+  inline void AllocateMemory(PageSizeClass size_class) {
+    size_class_ = size_class;
+    data_ = new char[GetSize()];
+  }
 
   /** The actual data that is stored within a page. */
   // Usually this should be stored as `char data_[BUSTUB_PAGE_SIZE]{};`. But to enable ASAN to detect page overflow,
   // we store it as a ptr.
   char *data_;
+  /** The size of data_, and of the page in it. */
+  PageSizeClass size_class_ = PageSizeClass::Size4K;
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /**
+   * The pin count of this page. It only goes up from zero under the buffer pool latch, so that an unpinned page can
+   * be evicted under the latch, but an extra pin on a pinned page may be taken without it.
+   */
+  std::atomic<int> pin_count_ = 0;
+  /** How many of the pins are parked in thread pin caches, taken back without the latch. */
+  std::atomic<int> parked_pins_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /**
+   * Recovery LSN: every change to the page that may be missing on disk has an LSN >= rec_lsn_. It is the log's
+   * next LSN at the time the page was last known to be clean, and is only meaningful while the page is dirty.
+   */
+  lsn_t rec_lsn_ = 0;
+  /** Bytes modified since the page was last written back, only meaningful while the page is dirty. */
+  DirtyRangeSet dirty_ranges_;
+  /** Bumped whenever an unpin reports the page dirty, so a background write can tell if it missed a change. */
+  uint64_t dirty_version_ = 0;
+  /** Offsets of the swips in this page that the buffer pool swizzled. */
+  std::vector<uint32_t> swizzled_swips_;
+  /** The page holding the one swizzled swip that points at this frame, nullptr if there is none. */
+  Page *swip_parent_ = nullptr;
+  /** Offset of that swip in the parent's data, only meaningful while swip_parent_ is set. */
+  uint32_t swip_offset_ = 0;
+  /** True if the page is permanently resident, i.e. its frame is kept out of the replacer's bookkeeping. */
+  bool is_resident_ = false;
   /** Page latch. */
-  ReaderWriterLatch rwlatch_;
+  PageLatch rwlatch_;
 };
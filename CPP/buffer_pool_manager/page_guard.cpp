@@ -1,26 +1,36 @@
 #include "page_guard.h"
 #include "buffer_pool_manager.h"
 
+#include <algorithm>
+#include <utility>
+
 BasicPageGuard::BasicPageGuard(BasicPageGuard &&that) noexcept {
   this->bpm_ = that.bpm_;
   this->page_ = that.page_;
   this->is_dirty_ = that.is_dirty_;
+  this->dirty_ranges_ = that.dirty_ranges_;
   // Set to Nullptr
   that.page_ = nullptr;
   that.bpm_ = nullptr;
   that.is_dirty_ = false;
+  that.dirty_ranges_.Clear();
 }
 
 void BasicPageGuard::Drop() {
   // We are done with this page
   if (bpm_ != nullptr && page_ != nullptr) {
     // For the destructor, preventing dropping twice...
-    bpm_->UnpinPage(PageId(), is_dirty_);
+    if (is_dirty_ && dirty_ranges_.IsEmpty()) {
+      // Dirty without saying where, assume anything may have changed
+      dirty_ranges_.MarkAll();
+    }
+    bpm_->UnpinPage(PageId(), dirty_ranges_);
   }
   // Clear the content
   bpm_ = nullptr;
   page_ = nullptr;
   is_dirty_ = false;
+  dirty_ranges_.Clear();
 }
 
 auto BasicPageGuard::operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard & {
@@ -34,24 +44,47 @@ auto BasicPageGuard::operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard
   this->bpm_ = that.bpm_;
   this->page_ = that.page_;
   this->is_dirty_ = that.is_dirty_;
+  this->dirty_ranges_ = that.dirty_ranges_;
   // Set to Nullptr
   that.page_ = nullptr;
   that.bpm_ = nullptr;
   that.is_dirty_ = false;
+  that.dirty_ranges_.Clear();
 
   return *this;
 }
 
 BasicPageGuard::~BasicPageGuard() { Drop(); }  // NOLINT
 
+auto BasicPageGuard::UpgradeRead() -> ReadPageGuard {
+  ReadPageGuard read_guard;
+  if (page_ != nullptr) {
+    page_->RLatch();
+  }
+  // Hand over the pin, no round trip through the buffer pool
+  read_guard.guard_ = std::move(*this);
+  return read_guard;
+}
+
+auto BasicPageGuard::UpgradeWrite() -> WritePageGuard {
+  WritePageGuard write_guard;
+  if (page_ != nullptr) {
+    page_->WLatch();
+  }
+  write_guard.guard_ = std::move(*this);
+  return write_guard;
+}
+
 ReadPageGuard::ReadPageGuard(ReadPageGuard &&that) noexcept {
   guard_.bpm_ = that.guard_.bpm_;
   guard_.page_ = that.guard_.page_;
   guard_.is_dirty_ = that.guard_.is_dirty_;
+  guard_.dirty_ranges_ = that.guard_.dirty_ranges_;
   // Set to Nullptr
   that.guard_.bpm_ = nullptr;
   that.guard_.page_ = nullptr;
   that.guard_.is_dirty_ = false;
+  that.guard_.dirty_ranges_.Clear();
 }
 
 auto ReadPageGuard::operator=(ReadPageGuard &&that) noexcept -> ReadPageGuard & {
@@ -65,10 +98,12 @@ auto ReadPageGuard::operator=(ReadPageGuard &&that) noexcept -> ReadPageGuard &
   guard_.bpm_ = that.guard_.bpm_;
   guard_.page_ = that.guard_.page_;
   guard_.is_dirty_ = that.guard_.is_dirty_;
+  guard_.dirty_ranges_ = that.guard_.dirty_ranges_;
   // Set to Nullptr
   that.guard_.bpm_ = nullptr;
   that.guard_.page_ = nullptr;
   that.guard_.is_dirty_ = false;
+  that.guard_.dirty_ranges_.Clear();
 
   return *this;
 }
@@ -77,20 +112,44 @@ void ReadPageGuard::Drop() {
   if (guard_.page_ != nullptr) {
     guard_.page_->RUnlatch();
   }
-  guard_.is_dirty_ = false;
+  // Still dirty if it came from a downgraded WritePageGuard
   guard_.Drop();
 }
 
 ReadPageGuard::~ReadPageGuard() { Drop(); }  // NOLINT
 
+auto ReadPageGuard::TryUpgrade(WritePageGuard *write_guard) -> bool {
+  if (guard_.page_ == nullptr || !guard_.page_->TryUpgradeLatch()) {
+    return false;
+  }
+  write_guard->Drop();
+  write_guard->guard_ = std::move(guard_);
+  return true;
+}
+
+auto ReadPageGuard::Upgrade(bool *held_throughout) -> WritePageGuard {
+  WritePageGuard write_guard;
+  bool held = true;
+  if (guard_.page_ != nullptr) {
+    held = guard_.page_->UpgradeLatch();
+  }
+  if (held_throughout != nullptr) {
+    *held_throughout = held;
+  }
+  write_guard.guard_ = std::move(guard_);
+  return write_guard;
+}
+
 WritePageGuard::WritePageGuard(WritePageGuard &&that) noexcept {
   guard_.bpm_ = that.guard_.bpm_;
   guard_.page_ = that.guard_.page_;
   guard_.is_dirty_ = that.guard_.is_dirty_;
+  guard_.dirty_ranges_ = that.guard_.dirty_ranges_;
   // Set to Nullptr
   that.guard_.bpm_ = nullptr;
   that.guard_.page_ = nullptr;
   that.guard_.is_dirty_ = false;
+  that.guard_.dirty_ranges_.Clear();
 }
 
 auto WritePageGuard::operator=(WritePageGuard &&that) noexcept -> WritePageGuard & {
@@ -104,10 +163,12 @@ auto WritePageGuard::operator=(WritePageGuard &&that) noexcept -> WritePageGuard
   guard_.bpm_ = that.guard_.bpm_;
   guard_.page_ = that.guard_.page_;
   guard_.is_dirty_ = that.guard_.is_dirty_;
+  guard_.dirty_ranges_ = that.guard_.dirty_ranges_;
   // Set to Nullptr
   that.guard_.bpm_ = nullptr;
   that.guard_.page_ = nullptr;
   that.guard_.is_dirty_ = false;
+  that.guard_.dirty_ranges_.Clear();
 
   return *this;
 }
@@ -121,3 +182,48 @@ void WritePageGuard::Drop() {
 }
 
 WritePageGuard::~WritePageGuard() { Drop(); }  // NOLINT
+
+auto WritePageGuard::Downgrade() -> ReadPageGuard {
+  ReadPageGuard read_guard;
+  if (guard_.page_ != nullptr) {
+    guard_.page_->DowngradeLatch();
+    // Like Drop, a write guard counts as having modified the page
+    guard_.is_dirty_ = true;
+  }
+  read_guard.guard_ = std::move(guard_);
+  return read_guard;
+}
+
+auto MultiPageGuard::operator=(MultiPageGuard &&that) noexcept -> MultiPageGuard & {
+  if (this == &that) {
+    return *this;
+  }
+  Drop();
+  page_ids_ = std::move(that.page_ids_);
+  guards_ = std::move(that.guards_);
+  positions_ = std::move(that.positions_);
+  that.page_ids_.clear();
+  that.guards_.clear();
+  that.positions_.clear();
+  return *this;
+}
+
+void MultiPageGuard::Drop() {
+  // Release in reverse acquisition order, although any order would do
+  for (auto it = guards_.rbegin(); it != guards_.rend(); ++it) {
+    it->Drop();
+  }
+  page_ids_.clear();
+  guards_.clear();
+  positions_.clear();
+}
+
+MultiPageGuard::~MultiPageGuard() { Drop(); }  // NOLINT
+
+auto MultiPageGuard::Find(page_id_t page_id) -> WritePageGuard * {
+  auto it = std::lower_bound(page_ids_.begin(), page_ids_.end(), page_id);
+  if (it == page_ids_.end() || *it != page_id) {
+    return nullptr;
+  }
+  return &guards_[it - page_ids_.begin()];
+}
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <vector>
+
+#include "dirty_range_set.h"
 #include "page.h"
 
 
 class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
 
 class BasicPageGuard {
  public:
@@ -50,8 +55,10 @@ class BasicPageGuard {
     return reinterpret_cast<const T *>(GetData());
   }
 
+  /** Mutable access to the whole page, the page is written back in full. */
   auto GetDataMut() -> char * {
     is_dirty_ = true;
+    dirty_ranges_.MarkAll();
     return page_->GetData();
   }
 
@@ -60,6 +67,31 @@ class BasicPageGuard {
     return reinterpret_cast<T *>(GetDataMut());
   }
 
+  /**
+   * Mutable access to `size` bytes at `offset`. Only the ranges handed out this way are recorded as modified,
+   * which lets the buffer pool write a small change back as a delta.
+   */
+  auto GetDataMut(size_t offset, size_t size) -> char * {
+    is_dirty_ = true;
+    dirty_ranges_.Add(offset, offset + size);
+    return page_->GetData() + offset;
+  }
+
+  template <class T>
+  auto AsMut(size_t offset) -> T * {
+    return reinterpret_cast<T *>(GetDataMut(offset, sizeof(T)));
+  }
+
+  /**
+   * @brief Read-latch the page and hand the pin over to a ReadPageGuard. This guard is empty afterwards.
+   */
+  auto UpgradeRead() -> ReadPageGuard;
+
+  /**
+   * @brief Write-latch the page and hand the pin over to a WritePageGuard. This guard is empty afterwards.
+   */
+  auto UpgradeWrite() -> WritePageGuard;
+
  private:
   friend class ReadPageGuard;
   friend class WritePageGuard;
@@ -67,6 +99,8 @@ class BasicPageGuard {
   [[maybe_unused]] BufferPoolManager *bpm_{nullptr};
   Page *page_{nullptr};
   bool is_dirty_{false};
+  /** Bytes modified through this guard, an empty set on a dirty guard stands for the whole page. */
+  DirtyRangeSet dirty_ranges_;
 };
 
 class ReadPageGuard {
@@ -123,8 +157,30 @@ class ReadPageGuard {
     return guard_.As<T>();
   }
 
+  /**
+   * @brief Switch to the write latch on the same pinned frame, if no other thread holds the read latch. On
+   * success this guard is empty and the page is held by `write_guard`, which was latched without a gap; on
+   * failure nothing changes.
+   *
+   * @param[out] write_guard the guard that takes over the page
+   * @return true if the latch was upgraded
+   */
+  auto TryUpgrade(WritePageGuard *write_guard) -> bool;
+
+  /**
+   * @brief Switch to the write latch on the same pinned frame, waiting for the other readers to leave. This
+   * guard is empty afterwards. The page stays pinned throughout, but if another thread was upgrading the same
+   * page, the latch had to be released and acquired again, and the page may have changed in between.
+   *
+   * @param[out] held_throughout set to false if the latch was released in between, may be nullptr
+   * @return the write guard holding the page
+   */
+  auto Upgrade(bool *held_throughout = nullptr) -> WritePageGuard;
+
  private:
-  // You may choose to get rid of this and add your own private variables.
+  friend class BasicPageGuard;
+  friend class WritePageGuard;
+
   BasicPageGuard guard_;
 };
 
@@ -190,8 +246,70 @@ class WritePageGuard {
     return guard_.AsMut<T>();
   }
 
+  auto GetDataMut(size_t offset, size_t size) -> char * { return guard_.GetDataMut(offset, size); }
+
+  template <class T>
+  auto AsMut(size_t offset) -> T * {
+    return guard_.AsMut<T>(offset);
+  }
+
+  /**
+   * @brief Switch to a read latch on the same pinned frame, without releasing the latch. This guard is empty
+   * afterwards, the modifications made through it are written back when the read guard is dropped.
+   *
+   * @return the read guard holding the page
+   */
+  auto Downgrade() -> ReadPageGuard;
+
  private:
+  friend class BasicPageGuard;
+  friend class ReadPageGuard;
+
   BasicPageGuard guard_;
 };
 
+/**
+ * MultiPageGuard holds a set of pages write-latched together, for operations such as node splits and merges that
+ * modify several pages at once. See BufferPoolManager::FetchPagesWrite.
+ *
+ * The latches are acquired in ascending page id order and released together when the guard is dropped.
+ */
+class MultiPageGuard {
+ public:
+  MultiPageGuard() = default;
+  MultiPageGuard(const MultiPageGuard &) = delete;
+  auto operator=(const MultiPageGuard &) -> MultiPageGuard & = delete;
+  MultiPageGuard(MultiPageGuard &&that) noexcept = default;
+
+  /** @brief Move assignment, dropping the pages held before. */
+  auto operator=(MultiPageGuard &&that) noexcept -> MultiPageGuard &;
+
+  /** @brief Unlatch and unpin every page. */
+  void Drop();
+
+  ~MultiPageGuard();
+
+  /** @return true if no page is held, i.e. the pages could not be fetched */
+  auto IsEmpty() -> bool { return guards_.empty(); }
+
+  /**
+   * @param i position in the page ids the guard was fetched with
+   * @return the guard of that page, the same one for a page id given twice
+   */
+  auto operator[](size_t i) -> WritePageGuard & { return guards_[positions_[i]]; }
+
+  /** @return the guard of a page, nullptr if it is not held */
+  auto Find(page_id_t page_id) -> WritePageGuard *;
+
+ private:
+  friend class BufferPoolManager;
+
+  /** The distinct page ids, in ascending order. */
+  std::vector<page_id_t> page_ids_;
+  /** The guard of each of page_ids_. */
+  std::vector<WritePageGuard> guards_;
+  /** For each page id the guard was fetched with, the index of its guard. */
+  std::vector<size_t> positions_;
+};
+
 }  // namespace bustub
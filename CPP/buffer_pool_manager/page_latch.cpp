@@ -0,0 +1,133 @@
+#include "page_latch.h"
+
+#include <thread>  // NOLINT
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/** Spinning only pays off if the holder can run on another CPU meanwhile. */
+auto SpinRounds() -> int {
+  static const int ROUNDS = std::thread::hardware_concurrency() > 1 ? PageLatch::SPIN_ROUNDS : 0;
+  return ROUNDS;
+}
+
+}  // namespace
+
+void PageLatch::WLockSlow() {
+  // Announce the writer first, which holds off new readers while we wait for the current ones
+  uint32_t state = state_.fetch_add(WAITING_WRITER, std::memory_order_relaxed) + WAITING_WRITER;
+  int spins = 0;
+  const int max_spins = SpinRounds();
+  while (true) {
+    if ((state & (WRITER | READERS_MASK)) == 0) {
+      if (state_.compare_exchange_weak(state, (state - WAITING_WRITER) | WRITER, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+      continue;
+    }
+    if (spins < max_spins) {
+      spins += 1;
+      CpuRelax();
+    } else if (spins < max_spins + YIELD_ROUNDS) {
+      spins += 1;
+      std::this_thread::yield();
+    } else {
+      Park(state);
+    }
+    state = state_.load(std::memory_order_relaxed);
+  }
+}
+
+void PageLatch::RLockSlow() {
+  int spins = 0;
+  const int max_spins = SpinRounds();
+  uint32_t state = state_.load(std::memory_order_relaxed);
+  while (true) {
+    if (CanRead(state)) {
+      if (state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return;
+      }
+      continue;
+    }
+    if (spins < max_spins) {
+      spins += 1;
+      CpuRelax();
+    } else if (spins < max_spins + YIELD_ROUNDS) {
+      spins += 1;
+      std::this_thread::yield();
+    } else {
+      Park(state);
+    }
+    state = state_.load(std::memory_order_relaxed);
+  }
+}
+
+auto PageLatch::UpgradeSlow() -> bool {
+  uint32_t state = state_.load(std::memory_order_relaxed);
+  do {
+    if ((state & UPGRADER) != 0) {
+      // Someone else is upgrading and waits for us to leave
+      RUnlock();
+      WLock();
+      return false;
+    }
+  } while (!state_.compare_exchange_weak(state, state | UPGRADER, std::memory_order_relaxed));
+
+  int spins = 0;
+  const int max_spins = SpinRounds();
+  state = state_.load(std::memory_order_relaxed);
+  while (true) {
+    // No writer can get in while we hold our share, so only the other readers are left to wait for
+    if ((state & READERS_MASK) == 1) {
+      if (state_.compare_exchange_weak(state, (state - 1 - UPGRADER) | WRITER, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+      continue;
+    }
+    if (spins < max_spins) {
+      spins += 1;
+      CpuRelax();
+    } else if (spins < max_spins + YIELD_ROUNDS) {
+      spins += 1;
+      std::this_thread::yield();
+    } else {
+      Park(state);
+    }
+    state = state_.load(std::memory_order_relaxed);
+  }
+}
+
+void PageLatch::Park(uint32_t state) {
+  // Pairs with the seq_cst release in WUnlock/RUnlock: either the releaser sees us parked and wakes us, or the
+  // futex sees the state it changed and doesn't sleep
+  parked_.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state_), FUTEX_WAIT_PRIVATE, state, nullptr, nullptr, 0);
+#else
+  if (state_.load(std::memory_order_seq_cst) == state) {
+    std::this_thread::yield();
+  }
+#endif
+  parked_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void PageLatch::WakeAll() {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state_), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
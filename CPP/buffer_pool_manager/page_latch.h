@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * PageLatch is the reader-writer latch guarding a page's data, tuned for the short critical sections page
+ * latches protect.
+ *
+ * A contended acquire first spins for a bounded number of rounds, since the holder is most likely about to
+ * release, then yields the CPU a few times, which lets a preempted holder finish when the machine is
+ * oversubscribed, and only then parks the thread on a futex. It prefers writers: once a writer is waiting, new readers
+ * queue up behind it, so a steady stream of readers can't starve it. The flip side is that a thread must not
+ * read-latch a page it already holds read-latched: a writer arriving in between would wait for the first hold
+ * while the second waits for the writer. ReaderWriterLatch, which let the second read in, did not have this
+ * restriction. benchmark/page_latch_bench.cpp compares the two.
+ *
+ * A reader can upgrade its hold to an exclusive one and a writer can downgrade its hold to a shared one without
+ * releasing the latch in between.
+ *
+ * The whole latch is two 32-bit words: the state {writer, upgrader, waiting writers, readers}, which doubles as the
+ * futex word, and the number of parked threads, so a release only makes a syscall when someone sleeps.
+ */
+class PageLatch {
+ public:
+  PageLatch() = default;
+
+  DISALLOW_COPY_AND_MOVE(PageLatch);
+
+  /** Acquire the latch exclusively. */
+  void WLock() {
+    uint32_t state = 0;
+    if (!state_.compare_exchange_strong(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+      WLockSlow();
+    }
+  }
+
+  /** Release an exclusive hold. */
+  void WUnlock() {
+    state_.fetch_and(~WRITER, std::memory_order_seq_cst);
+    WakeParked();
+  }
+
+  /** Acquire the latch shared. */
+  void RLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if (!CanRead(state) ||
+        !state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      RLockSlow();
+    }
+  }
+
+  /** Release a shared hold. */
+  void RUnlock() {
+    uint32_t state = state_.fetch_sub(1, std::memory_order_seq_cst) - 1;
+    if ((state & READERS_MASK) == 0 || (state & UPGRADER) != 0) {
+      // Only a waiting writer cares about the last reader leaving, or an upgrader about the last but itself
+      WakeParked();
+    }
+  }
+
+  /**
+   * Turn a shared hold into an exclusive one if this is the only reader, without releasing the latch.
+   * @return true if the latch is now held exclusively, false if it is still held shared
+   */
+  auto TryUpgrade() -> bool {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & READERS_MASK) == 1 && (state & UPGRADER) == 0) {
+      if (state_.compare_exchange_weak(state, (state - 1) | WRITER, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Turn a shared hold into an exclusive one, waiting for the other readers to leave. Only one reader can
+   * upgrade at a time: while it waits, new readers are held off, and a second upgrader has to release its shared
+   * hold and acquire the latch exclusively from scratch, since the two would otherwise wait for each other.
+   * @return true if the latch was held throughout, false if it was released in between
+   */
+  auto Upgrade() -> bool { return TryUpgrade() || UpgradeSlow(); }
+
+  /** Turn an exclusive hold into a shared one, without releasing the latch. */
+  void Downgrade() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while (!state_.compare_exchange_weak(state, (state & ~WRITER) + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+    }
+    WakeParked();
+  }
+
+  /** @return true if the latch was acquired exclusively without waiting */
+  auto TryWLock() -> bool {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    return (state & (WRITER | READERS_MASK)) == 0 &&
+           state_.compare_exchange_strong(state, state | WRITER, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  /** @return true if the latch was acquired shared without waiting */
+  auto TryRLock() -> bool {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while (CanRead(state)) {
+      if (state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** Rounds a contended acquire spins before it parks, on machines with more than one CPU. */
+  static constexpr int SPIN_ROUNDS = 64;
+
+  /** Times a contended acquire yields after spinning and before it parks. */
+  static constexpr int YIELD_ROUNDS = 4;
+
+ private:
+  static constexpr uint32_t READERS_MASK = 0xFFFF;
+  static constexpr uint32_t WAITING_WRITER = 1U << 16;
+  static constexpr uint32_t WAITING_WRITERS_MASK = 0x3FFFU << 16;
+  /** Set while a reader waits in Upgrade for the other readers to leave. */
+  static constexpr uint32_t UPGRADER = 1U << 30;
+  static constexpr uint32_t WRITER = 1U << 31;
+
+  /** A reader may enter when no writer holds the latch or waits for it. */
+  static auto CanRead(uint32_t state) -> bool {
+    return (state & (WRITER | UPGRADER | WAITING_WRITERS_MASK)) == 0;
+  }
+
+  void WLockSlow();
+
+  void RLockSlow();
+
+  auto UpgradeSlow() -> bool;
+
+  /** @brief Park until the state word no longer holds the given value, or a spurious wakeup. */
+  void Park(uint32_t state);
+
+  /** @brief Wake every parked thread, if there is any. */
+  void WakeParked() {
+    if (parked_.load(std::memory_order_seq_cst) != 0) {
+      WakeAll();
+    }
+  }
+
+  void WakeAll();
+
+  std::atomic<uint32_t> state_{0};
+  std::atomic<uint32_t> parked_{0};
+};
+
+static_assert(sizeof(PageLatch) == 8);
@@ -0,0 +1,124 @@
+#include "page_table.h"
+
+PageTable::PageTable() : directory_(new std::atomic<std::atomic<frame_id_t> *>[DIRECTORY_SIZE]) {
+  for (size_t i = 0; i < DIRECTORY_SIZE; ++i) {
+    directory_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+PageTable::~PageTable() {
+  if (directory_ == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < DIRECTORY_SIZE; ++i) {
+    delete[] directory_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void PageTable::EnableHashing(size_t max_entries) {
+  for (size_t i = 0; directory_ != nullptr && i < DIRECTORY_SIZE; ++i) {
+    if (directory_[i].load(std::memory_order_relaxed) != nullptr) {
+      throw bustub::Exception("page table must be empty to switch to hashing");
+    }
+  }
+  directory_.reset();
+
+  // At most half full, which keeps probe sequences short and guarantees every probe meets an empty slot
+  size_t capacity = 16;
+  hash_shift_ = 60;
+  while (capacity < 2 * max_entries) {
+    capacity <<= 1;
+    hash_shift_ -= 1;
+  }
+  slots_.reset(new std::atomic<uint64_t>[capacity]);
+  for (size_t i = 0; i < capacity; ++i) {
+    slots_[i].store(EMPTY_SLOT, std::memory_order_relaxed);
+  }
+  mask_ = capacity - 1;
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  if (slots_ != nullptr) {
+    InsertHashed(page_id, frame_id);
+    return;
+  }
+  std::atomic<std::atomic<frame_id_t> *> &slot = directory_[page_id >> CHUNK_BITS];
+  std::atomic<frame_id_t> *chunk = slot.load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    chunk = new std::atomic<frame_id_t>[CHUNK_SIZE];
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+      chunk[i].store(NO_FRAME, std::memory_order_relaxed);
+    }
+    // Publish the chunk only once it is initialized
+    slot.store(chunk, std::memory_order_release);
+  }
+  chunk[page_id & (CHUNK_SIZE - 1)].store(frame_id, std::memory_order_release);
+}
+
+void PageTable::Erase(page_id_t page_id) {
+  if (page_id < 0) {
+    return;
+  }
+  if (slots_ != nullptr) {
+    EraseHashed(page_id);
+    return;
+  }
+  std::atomic<frame_id_t> *chunk = directory_[page_id >> CHUNK_BITS].load(std::memory_order_relaxed);
+  if (chunk != nullptr) {
+    chunk[page_id & (CHUNK_SIZE - 1)].store(NO_FRAME, std::memory_order_release);
+  }
+}
+
+void PageTable::InsertHashed(page_id_t page_id, frame_id_t frame_id) {
+  size_t i = HomeSlot(page_id);
+  while (true) {
+    uint64_t slot = slots_[i].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      if (2 * (num_entries_ + 1) > mask_ + 1) {
+        throw bustub::Exception("page table holds more pages than it was sized for");
+      }
+      num_entries_ += 1;
+      break;
+    }
+    if (KeyOf(slot) == page_id) {
+      break;
+    }
+    i = (i + 1) & mask_;
+  }
+  // Entries never move on insert, so a concurrent Find needs no seqlock retry for this
+  slots_[i].store(MakeSlot(page_id, frame_id), std::memory_order_release);
+}
+
+void PageTable::EraseHashed(page_id_t page_id) {
+  size_t hole = HomeSlot(page_id);
+  while (true) {
+    uint64_t slot = slots_[hole].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      return;
+    }
+    if (KeyOf(slot) == page_id) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  uint64_t version = version_.load(std::memory_order_relaxed);
+  version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  // Move back every later entry of the cluster that the hole now cuts off from its home slot
+  for (size_t next = (hole + 1) & mask_;; next = (next + 1) & mask_) {
+    uint64_t slot = slots_[next].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      break;
+    }
+    size_t home = HomeSlot(KeyOf(slot));
+    bool reachable = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+    if (!reachable) {
+      slots_[hole].store(slot, std::memory_order_relaxed);
+      hole = next;
+    }
+  }
+  slots_[hole].store(EMPTY_SLOT, std::memory_order_relaxed);
+  num_entries_ -= 1;
+  version_.store(version + 2, std::memory_order_release);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT
+
+/**
+ * PageTable maps page ids to the frames holding them. It works in one of two modes.
+ *
+ * Direct-mapped (the default) exploits the fact that page ids are handed out densely from zero. The array is
+ * split in two levels: a directory of chunk pointers indexed by the high bits of the page id, and chunks of
+ * CHUNK_SIZE frame ids indexed by the low bits. A lookup is therefore two dependent loads, with no hashing and no
+ * pointer chasing through nodes. A chunk is allocated the first time a page id in its range is inserted and lives
+ * as long as the table, so inserts past warm-up never allocate and the memory used grows with the highest page id
+ * rather than with the number of pages in the pool.
+ *
+ * Hashed, for sparse or recycled page ids, is an open-addressing hash table with linear probing. Each slot is a
+ * single 64-bit word holding both the page id and the frame id, eight to a cache line, so a probe sequence is
+ * usually one cache line. The table is sized once for the number of frames, at most half full, and never
+ * allocates afterwards. Erase uses backward-shift deletion, so there are no tombstones to clean up.
+ *
+ * In both modes Find is lock-free and may run concurrently with Insert and Erase: it sees either the old or the
+ * new frame of the page being changed, and the right frame of every other page. Insert and Erase themselves have
+ * to be serialized by the caller. The buffer pool looks pages up without its latch on the fetch fast path, see
+ * BufferPoolManager::PinLatchFree, and updates the table under it.
+ */
+class PageTable {
+ public:
+  PageTable();
+
+  ~PageTable();
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  /**
+   * @brief Switch to the hashed mode. The table must be empty.
+   * @param max_entries most pages the table will hold at once, i.e. the number of frames
+   */
+  void EnableHashing(size_t max_entries);
+
+  /**
+   * @brief Look up the frame holding a page.
+   * @param page_id id of the page
+   * @return the frame id, or NO_FRAME if the page is not in the table
+   */
+  auto Find(page_id_t page_id) const -> frame_id_t {
+    return slots_ != nullptr ? FindHashed(page_id) : FindDirect(page_id);
+  }
+
+  /**
+   * @brief Map a page to a frame. In direct-mapped mode, this allocates the page's chunk if this is the first page
+   * id in its range.
+   * @param page_id id of the page, must not be negative
+   * @param frame_id the frame holding the page
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * @brief Remove the mapping of a page, if there is one.
+   * @param page_id id of the page
+   */
+  void Erase(page_id_t page_id);
+
+  /** Returned by Find for a page that is not in the table. */
+  static constexpr frame_id_t NO_FRAME = -1;
+
+ private:
+  /** 16K entries, 64 KB, per chunk. */
+  static constexpr int CHUNK_BITS = 14;
+  static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_BITS;
+  /** Enough chunks to cover every non-negative page_id_t. */
+  static constexpr size_t DIRECTORY_SIZE = (size_t{1} << 31) / CHUNK_SIZE;
+
+  /** A hash slot that holds no page. No page has the key of INVALID_PAGE_ID. */
+  static constexpr uint64_t EMPTY_SLOT = ~uint64_t{0};
+
+  auto FindDirect(page_id_t page_id) const -> frame_id_t {
+    if (page_id < 0) {
+      return NO_FRAME;
+    }
+    const std::atomic<frame_id_t> *chunk = directory_[page_id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      return NO_FRAME;
+    }
+    return chunk[page_id & (CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+  }
+
+  auto FindHashed(page_id_t page_id) const -> frame_id_t {
+    while (true) {
+      uint64_t version = version_.load(std::memory_order_acquire);
+      if ((version & 1) != 0) {
+        // An Erase is moving entries around
+        std::this_thread::yield();
+        continue;
+      }
+      frame_id_t frame_id = NO_FRAME;
+      for (size_t i = HomeSlot(page_id);; i = (i + 1) & mask_) {
+        uint64_t slot = slots_[i].load(std::memory_order_relaxed);
+        if (slot == EMPTY_SLOT) {
+          break;
+        }
+        if (KeyOf(slot) == page_id) {
+          frame_id = FrameOf(slot);
+          break;
+        }
+      }
+      // An entry may have been shifted past us while we probed, in which case look again
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version_.load(std::memory_order_relaxed) == version) {
+        return frame_id;
+      }
+    }
+  }
+
+  /** @return the slot a page's probe sequence starts at, by Fibonacci hashing */
+  auto HomeSlot(page_id_t page_id) const -> size_t {
+    return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(page_id)) * 0x9E3779B97F4A7C15ULL) >>
+                               hash_shift_);
+  }
+
+  static auto MakeSlot(page_id_t page_id, frame_id_t frame_id) -> uint64_t {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) | static_cast<uint32_t>(frame_id);
+  }
+
+  static auto KeyOf(uint64_t slot) -> page_id_t { return static_cast<page_id_t>(slot >> 32); }
+
+  static auto FrameOf(uint64_t slot) -> frame_id_t { return static_cast<frame_id_t>(slot & 0xFFFFFFFFU); }
+
+  void InsertHashed(page_id_t page_id, frame_id_t frame_id);
+
+  void EraseHashed(page_id_t page_id);
+
+  /** Direct-mapped mode: the chunk directory, nullptr in hashed mode. */
+  std::unique_ptr<std::atomic<std::atomic<frame_id_t> *>[]> directory_;
+
+  /** Hashed mode: the slots, a power of two of them, nullptr in direct-mapped mode. */
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+  size_t mask_{0};
+  int hash_shift_{64};
+  size_t num_entries_{0};
+  /** Seqlock for Find against the entries moved by Erase, odd while an Erase is moving them. */
+  std::atomic<uint64_t> version_{0};
+};
@@ -0,0 +1,288 @@
+#include "segmented_disk_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+SegmentedDiskManager::SegmentedDiskManager(std::vector<std::string> directories, const std::string &name,
+                                           size_t pages_per_segment, size_t pages_per_extent)
+    : directories_(std::move(directories)),
+      name_(name),
+      pages_per_segment_(pages_per_segment),
+      pages_per_extent_(std::min(std::max<size_t>(pages_per_extent, 1), pages_per_segment)) {
+  if (directories_.empty() || pages_per_segment_ == 0) {
+    throw bustub::Exception("segmented disk manager needs a directory and a non-empty segment size");
+  }
+  file_name_ = SegmentPath(0);
+  log_name_ = directories_[0] + "/" + name_ + ".log";
+  size_class_name_ = directories_[0] + "/" + name_ + ".classes";
+  log_file_.Open(log_name_);
+  RecoverAllocationEnd();
+}
+
+SegmentedDiskManager::~SegmentedDiskManager() { ShutDown(); }
+
+void SegmentedDiskManager::ShutDown() {
+  std::scoped_lock scoped_lock(latch_);
+  for (auto &fd : segment_fds_) {
+    if (fd >= 0) {
+      fsync(fd);
+      close(fd);
+      fd = -1;
+    }
+  }
+  log_file_.Close();
+}
+
+auto SegmentedDiskManager::SegmentPath(size_t segment) const -> std::string {
+  return directories_[segment % directories_.size()] + "/" + name_ + "." + std::to_string(segment);
+}
+
+auto SegmentedDiskManager::OpenSegment(size_t segment, bool create) -> int {
+  if (segment < segment_fds_.size() && segment_fds_[segment] >= 0) {
+    return segment_fds_[segment];
+  }
+
+  std::string path = SegmentPath(segment);
+  int fd = open(path.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+  if (fd < 0) {
+    if (!create && errno == ENOENT) {
+      return -1;
+    }
+    throw bustub::Exception("can't open segment file " + path);
+  }
+  if (segment >= segment_fds_.size()) {
+    segment_fds_.resize(segment + 1, -1);
+  }
+  segment_fds_[segment] = fd;
+  return fd;
+}
+
+void SegmentedDiskManager::RecoverAllocationEnd() {
+  std::scoped_lock scoped_lock(latch_);
+  // Allocation hands out ids in order, so the segments in use are 0..n-1
+  size_t segment = 0;
+  while (OpenSegment(segment, false) >= 0) {
+    ++segment;
+  }
+  if (segment == 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(segment_fds_[segment - 1], &st) != 0) {
+    throw bustub::Exception("can't stat segment file " + SegmentPath(segment - 1));
+  }
+  uint64_t pages_in_last = (static_cast<uint64_t>(st.st_size) + BUSTUB_PAGE_SIZE - 1) / BUSTUB_PAGE_SIZE;
+  next_page_id_ = static_cast<page_id_t>((segment - 1) * pages_per_segment_ + pages_in_last);
+  reserved_end_ = next_page_id_;
+}
+
+void SegmentedDiskManager::Reserve(page_id_t first_page, size_t num_pages) {
+  int fd = OpenSegment(static_cast<uint64_t>(first_page) / pages_per_segment_, true);
+  // Keep the file size, it tells where allocation resumes after a restart. Preallocation is only an
+  // optimization, so a filesystem that doesn't support it just allocates blocks on write.
+  if (fallocate(fd, FALLOC_FL_KEEP_SIZE, SegmentOffset(first_page),
+                static_cast<off_t>(num_pages) * static_cast<off_t>(BUSTUB_PAGE_SIZE)) != 0 &&
+      errno != EOPNOTSUPP) {
+    throw bustub::Exception("can't preallocate segment file " + SegmentPath(first_page / pages_per_segment_));
+  }
+}
+
+auto SegmentedDiskManager::AllocatePage() -> page_id_t {
+  std::scoped_lock scoped_lock(latch_);
+  if (!free_pages_.empty()) {
+    page_id_t page_id = *free_pages_.begin();
+    free_pages_.erase(free_pages_.begin());
+    // Take back the block the hole punch gave away
+    Reserve(page_id, 1);
+    return page_id;
+  }
+  if (next_page_id_ >= reserved_end_) {
+    // Grow by one extent, without crossing into the next segment
+    size_t in_segment = static_cast<uint64_t>(next_page_id_) % pages_per_segment_;
+    size_t num_pages = std::min(pages_per_extent_, pages_per_segment_ - in_segment);
+    Reserve(next_page_id_, num_pages);
+    reserved_end_ = next_page_id_ + static_cast<page_id_t>(num_pages);
+  }
+  return next_page_id_++;
+}
+
+auto SegmentedDiskManager::AllocatePages(size_t num_pages, page_id_t *page_id) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  if (num_pages == 0 || num_pages > pages_per_segment_) {
+    return false;
+  }
+  // Lowest run of deallocated ids that doesn't cross a segment boundary
+  auto it = free_pages_.begin();
+  while (it != free_pages_.end()) {
+    page_id_t first = *it;
+    auto end = it;
+    size_t run = 0;
+    while (end != free_pages_.end() && run < num_pages && *end == first + static_cast<page_id_t>(run)) {
+      ++end;
+      ++run;
+    }
+    if (run == num_pages && static_cast<uint64_t>(first) % pages_per_segment_ + num_pages <= pages_per_segment_) {
+      free_pages_.erase(it, end);
+      Reserve(first, num_pages);
+      *page_id = first;
+      return true;
+    }
+    it = run == num_pages ? std::next(it) : end;
+  }
+
+  size_t in_segment = static_cast<uint64_t>(next_page_id_) % pages_per_segment_;
+  if (in_segment + num_pages > pages_per_segment_) {
+    // Start the next segment, the ids skipped here are handed out by later allocations
+    for (size_t i = in_segment; i < pages_per_segment_; ++i) {
+      free_pages_.insert(next_page_id_++);
+    }
+    in_segment = 0;
+  }
+  if (next_page_id_ + static_cast<page_id_t>(num_pages) > reserved_end_) {
+    size_t extent = std::min(std::max(pages_per_extent_, num_pages), pages_per_segment_ - in_segment);
+    Reserve(next_page_id_, extent);
+    reserved_end_ = next_page_id_ + static_cast<page_id_t>(extent);
+  }
+  *page_id = next_page_id_;
+  next_page_id_ += static_cast<page_id_t>(num_pages);
+  return true;
+}
+
+void SegmentedDiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_lock(latch_);
+  if (page_id < 0 || page_id >= next_page_id_ || !free_pages_.insert(page_id).second) {
+    return;
+  }
+  int fd = OpenSegment(static_cast<uint64_t>(page_id) / pages_per_segment_, false);
+  if (fd < 0) {
+    return;
+  }
+  if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, SegmentOffset(page_id),
+                static_cast<off_t>(BUSTUB_PAGE_SIZE)) == 0) {
+    return;
+  }
+  // No hole punching here, zero the page so that it still reads as zeroes
+  char zeroes[BUSTUB_PAGE_SIZE] = {};
+  if (errno != EOPNOTSUPP ||
+      pwrite(fd, zeroes, BUSTUB_PAGE_SIZE, SegmentOffset(page_id)) != static_cast<ssize_t>(BUSTUB_PAGE_SIZE)) {
+    throw bustub::Exception("I/O error while deallocating page");
+  }
+}
+
+void SegmentedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  int fd = GetSegment(static_cast<uint64_t>(page_id) / pages_per_segment_, true);
+  if (pwrite(fd, page_data, BUSTUB_PAGE_SIZE, SegmentOffset(page_id)) != static_cast<ssize_t>(BUSTUB_PAGE_SIZE)) {
+    throw bustub::Exception("I/O error while writing page");
+  }
+  num_page_writes_ += 1;
+}
+
+void SegmentedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  int fd = GetSegment(static_cast<uint64_t>(page_id) / pages_per_segment_, false);
+  ssize_t read_count = 0;
+  if (fd >= 0) {
+    read_count = pread(fd, page_data, BUSTUB_PAGE_SIZE, SegmentOffset(page_id));
+    if (read_count < 0) {
+      throw bustub::Exception("I/O error while reading page");
+    }
+  }
+  if (read_count < static_cast<ssize_t>(BUSTUB_PAGE_SIZE)) {
+    memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
+  }
+  num_page_reads_ += 1;
+}
+
+void SegmentedDiskManager::WritePages(page_id_t page_id, const char *page_data, size_t num_pages) {
+  while (num_pages > 0) {
+    // The part of the page that falls into this segment
+    size_t run = std::min(num_pages, pages_per_segment_ - static_cast<uint64_t>(page_id) % pages_per_segment_);
+    auto size = static_cast<ssize_t>(run * BUSTUB_PAGE_SIZE);
+    int fd = GetSegment(static_cast<uint64_t>(page_id) / pages_per_segment_, true);
+    if (pwrite(fd, page_data, size, SegmentOffset(page_id)) != size) {
+      throw bustub::Exception("I/O error while writing pages");
+    }
+    num_page_writes_ += run;
+    page_id += static_cast<page_id_t>(run);
+    page_data += size;
+    num_pages -= run;
+  }
+}
+
+void SegmentedDiskManager::ReadPages(page_id_t page_id, char *page_data, size_t num_pages) {
+  while (num_pages > 0) {
+    size_t run = std::min(num_pages, pages_per_segment_ - static_cast<uint64_t>(page_id) % pages_per_segment_);
+    auto size = static_cast<ssize_t>(run * BUSTUB_PAGE_SIZE);
+    int fd = GetSegment(static_cast<uint64_t>(page_id) / pages_per_segment_, false);
+    ssize_t read_count = 0;
+    if (fd >= 0) {
+      read_count = pread(fd, page_data, size, SegmentOffset(page_id));
+      if (read_count < 0) {
+        throw bustub::Exception("I/O error while reading pages");
+      }
+    }
+    if (read_count < size) {
+      memset(page_data + read_count, 0, size - read_count);
+    }
+    num_page_reads_ += run;
+    page_id += static_cast<page_id_t>(run);
+    page_data += size;
+    num_pages -= run;
+  }
+}
+
+void SegmentedDiskManager::Sync() {
+  std::vector<int> fds;
+  {
+    std::scoped_lock scoped_lock(latch_);
+    fds = segment_fds_;
+  }
+  for (int fd : fds) {
+    if (fd >= 0 && fdatasync(fd) != 0) {
+      throw bustub::Exception("I/O error while syncing segment file");
+    }
+  }
+}
+
+void SegmentedDiskManager::WriteLog(char *log_data, int size) {
+  log_file_.Append(log_data, size);
+  std::scoped_lock scoped_lock(latch_);
+  num_flushes_ += 1;
+}
+
+auto SegmentedDiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
+  return log_file_.Read(log_data, size, offset);
+}
+
+auto SegmentedDiskManager::GetNumSegments() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  size_t num_segments = 0;
+  for (int fd : segment_fds_) {
+    num_segments += fd >= 0 ? 1 : 0;
+  }
+  return num_segments;
+}
+
+auto SegmentedDiskManager::GetStorageSize() -> uint64_t {
+  std::scoped_lock scoped_lock(latch_);
+  uint64_t storage_size = 0;
+  for (int fd : segment_fds_) {
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0) {
+      // Blocks actually allocated, which counts preallocated extents and leaves out punched holes
+      storage_size += static_cast<uint64_t>(st.st_blocks) * 512;
+    }
+  }
+  return storage_size;
+}
+
+auto SegmentedDiskManager::GetNumFreePages() -> size_t {
+  std::scoped_lock scoped_lock(latch_);
+  return free_pages_.size();
+}
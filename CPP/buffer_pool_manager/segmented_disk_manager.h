@@ -0,0 +1,200 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <vector>
+
+#include "disk_manager.h"
+#include "log_file.h"
+
+/**
+ * SegmentedDiskManager is a storage backend that spreads the database over fixed-size segment files.
+ *
+ * Page `p` lives in segment `p / pages_per_segment` at byte offset `(p % pages_per_segment) * BUSTUB_PAGE_SIZE`.
+ * Segment `s` is the file `<directories[s % n]>/<name>.<s>`, so consecutive segments are striped round-robin over
+ * the given directories, which can sit on different devices for parallel bandwidth. All sizes and offsets are
+ * 64-bit, so the database is bounded by the page id space rather than by the size of a single file.
+ *
+ * New page ids are handed out by AllocatePage from the end of the database, which grows in extents of
+ * pages_per_extent pages reserved with fallocate. This keeps consecutively allocated pages physically sequential
+ * and takes block allocation off the write path. DeallocatePage punches a hole for the page, giving its blocks
+ * back to the filesystem, and the freed id is reused by a later AllocatePage, lowest id first. Pages that were
+ * never written or were deallocated read as zeroes.
+ *
+ * The free list lives in memory only. On reopen, allocation resumes after the last page of the last segment,
+ * and holes punched before the restart stay holes until their page is written again.
+ */
+class SegmentedDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new segmented disk manager.
+   * @param directories the directories to stripe the segment files over, the log goes to the first one
+   * @param name base name of the segment files, segments are named `<name>.<segment>` and the log `<name>.log`
+   * @param pages_per_segment number of pages in each segment file
+   * @param pages_per_extent number of pages reserved at a time as the database grows
+   */
+  SegmentedDiskManager(std::vector<std::string> directories, const std::string &name,
+                       size_t pages_per_segment = DEFAULT_PAGES_PER_SEGMENT,
+                       size_t pages_per_extent = DEFAULT_PAGES_PER_EXTENT);
+
+  ~SegmentedDiskManager() override;
+
+  /**
+   * Shut down the disk manager and close all the file resources.
+   */
+  void ShutDown();
+
+  /**
+   * Hand out a deallocated page id if there is one, or the next page at the end of the database, reserving a new
+   * extent when the current one is used up.
+   * @return the id of the allocated page
+   */
+  auto AllocatePage() -> page_id_t override;
+
+  /**
+   * Hand out a run of consecutive page ids within one segment: a run of deallocated ids if there is one, otherwise
+   * the next pages at the end of the database. If the run doesn't fit in the rest of the last segment, that rest
+   * goes to the free list and the run starts the next segment.
+   * @param num_pages number of ids, at most pages_per_segment
+   * @param[out] page_id the first id of the run
+   * @return false if the run is longer than a segment
+   */
+  auto AllocatePages(size_t num_pages, page_id_t *page_id) -> bool override;
+
+  /**
+   * Punch a hole for a page and make its id available for reuse.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id) override;
+
+  /**
+   * Write a page to its segment, creating the segment if needed.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Read a page from its segment. Pages that were never written read as zeroes.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Write a multi-block page with one pwrite per segment it spans, a single one for pages from AllocatePages.
+   * @param page_id id of the first block
+   * @param page_data raw page data, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  void WritePages(page_id_t page_id, const char *page_data, size_t num_pages) override;
+
+  /**
+   * Read a multi-block page with one pread per segment it spans. Blocks that were never written read as zeroes.
+   * @param page_id id of the first block
+   * @param[out] page_data output buffer, num_pages * BUSTUB_PAGE_SIZE bytes
+   * @param num_pages number of blocks
+   */
+  void ReadPages(page_id_t page_id, char *page_data, size_t num_pages) override;
+
+  /**
+   * Make every segment written so far durable.
+   */
+  void Sync() override;
+
+  /**
+   * Append to the log file `<directories[0]>/<name>.log` and make it durable.
+   * @param log_data raw log data
+   * @param size size of log entry
+   */
+  void WriteLog(char *log_data, int size) override;
+
+  /** WriteLog is durable already. */
+  void SyncLog() override {}
+
+  /**
+   * Read a log entry from the log file.
+   * @param[out] log_data output buffer
+   * @param size size of the log entry
+   * @param offset offset of the log entry in the file
+   * @return true if the read was successful, false otherwise
+   */
+  auto ReadLog(char *log_data, int size, int offset) -> bool override;
+
+  /** @return the number of segment files opened so far */
+  auto GetNumSegments() -> size_t;
+
+  /** @return the number of bytes of disk space allocated to the segment files opened so far */
+  auto GetStorageSize() -> uint64_t;
+
+  /** @return the number of deallocated page ids waiting for reuse */
+  auto GetNumFreePages() -> size_t;
+
+  /** @return the number of page writes */
+  auto GetNumPageWrites() const -> uint64_t { return num_page_writes_; }
+
+  /** @return the number of page reads */
+  auto GetNumPageReads() const -> uint64_t { return num_page_reads_; }
+
+  /** 64 MB segments with the default page size. */
+  static constexpr size_t DEFAULT_PAGES_PER_SEGMENT = 16384;
+
+  /** 1 MB extents with the default page size. */
+  static constexpr size_t DEFAULT_PAGES_PER_EXTENT = 256;
+
+ private:
+  /** @return the path of a segment file */
+  auto SegmentPath(size_t segment) const -> std::string;
+
+  /**
+   * @brief Find the file descriptor of a segment.
+   * @param segment the segment number
+   * @param create whether to create the segment if it doesn't exist
+   * @return the file descriptor, -1 if the segment doesn't exist and create is false
+   */
+  auto GetSegment(size_t segment, bool create) -> int {
+    std::scoped_lock scoped_lock(latch_);
+    return OpenSegment(segment, create);
+  }
+
+  /** @brief Same as GetSegment. Caller should hold the latch. */
+  auto OpenSegment(size_t segment, bool create) -> int;
+
+  /** @brief Find where allocation resumes from the existing segment files. */
+  void RecoverAllocationEnd();
+
+  /**
+   * @brief Reserve disk space for a range of pages within one segment. Caller should hold the latch.
+   * @param first_page first page of the range
+   * @param num_pages number of pages in the range
+   */
+  void Reserve(page_id_t first_page, size_t num_pages);
+
+  /** @return the byte offset of a page in its segment */
+  auto SegmentOffset(page_id_t page_id) const -> off_t {
+    return static_cast<off_t>(static_cast<uint64_t>(page_id) % pages_per_segment_) *
+           static_cast<off_t>(BUSTUB_PAGE_SIZE);
+  }
+
+  std::vector<std::string> directories_;
+  std::string name_;
+  const size_t pages_per_segment_;
+  const size_t pages_per_extent_;
+  /** segment_fds_[s] is the file descriptor of segment s, -1 if it wasn't opened yet. */
+  std::vector<int> segment_fds_;
+  LogFile log_file_;
+  /** Next page id at the end of the database. */
+  page_id_t next_page_id_{0};
+  /** End of the space reserved so far, pages in [next_page_id_, reserved_end_) are preallocated. */
+  page_id_t reserved_end_{0};
+  /** Deallocated page ids, reused lowest first to keep the database compact. */
+  std::set<page_id_t> free_pages_;
+  std::atomic<uint64_t> num_page_writes_{0};
+  std::atomic<uint64_t> num_page_reads_{0};
+  /** Protects segment_fds_ and the allocation state. Page I/O itself runs without the latch. */
+  std::mutex latch_;
+};
@@ -0,0 +1,54 @@
+#include "size_class_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+auto SizeClassFile::Open(const std::string &file_name, bool create) -> bool {
+  fd_ = open(file_name.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+  if (fd_ < 0) {
+    if (!create && errno == ENOENT) {
+      return false;
+    }
+    throw bustub::Exception("can't open size class file " + file_name);
+  }
+  return true;
+}
+
+void SizeClassFile::Close() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void SizeClassFile::Write(page_id_t page_id, PageSizeClass size_class) {
+  auto value = static_cast<uint8_t>(size_class);
+  if (pwrite(fd_, &value, 1, static_cast<off_t>(page_id)) != 1 || fdatasync(fd_) != 0) {
+    throw bustub::Exception("I/O error while writing size class file");
+  }
+}
+
+auto SizeClassFile::ReadAll() -> std::vector<std::pair<page_id_t, PageSizeClass>> {
+  std::vector<std::pair<page_id_t, PageSizeClass>> classes;
+  uint8_t buffer[BUSTUB_PAGE_SIZE];
+  off_t offset = 0;
+  ssize_t read_count;
+  // The holes of the sparse file read as zeroes, i.e. Size4K
+  while ((read_count = pread(fd_, buffer, sizeof(buffer), offset)) > 0) {
+    for (ssize_t i = 0; i < read_count; ++i) {
+      if (buffer[i] >= NUM_PAGE_SIZE_CLASSES) {
+        throw bustub::Exception("size class file is corrupt");
+      }
+      if (buffer[i] != 0) {
+        classes.emplace_back(static_cast<page_id_t>(offset + i), static_cast<PageSizeClass>(buffer[i]));
+      }
+    }
+    offset += read_count;
+  }
+  if (read_count < 0) {
+    throw bustub::Exception("I/O error while reading size class file");
+  }
+  return classes;
+}
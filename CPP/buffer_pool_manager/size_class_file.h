@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "page.h"
+
+/**
+ * SizeClassFile records the size class of every page that spans several page ids, see PageSizeClass, so that the
+ * buffer pool can read such a page whole again after a restart instead of just its first block. It is a sparse
+ * file with one byte per page id, the size class of the page that starts there, written through a file
+ * descriptor and made durable on every change; large pages are allocated rarely enough for that.
+ */
+class SizeClassFile {
+ public:
+  SizeClassFile() = default;
+
+  DISALLOW_COPY_AND_MOVE(SizeClassFile);
+
+  ~SizeClassFile() { Close(); }
+
+  /**
+   * @brief Open the file.
+   * @param file_name the file name of the size class file
+   * @param create create the file if it doesn't exist
+   * @return false if the file doesn't exist and create is not set
+   */
+  auto Open(const std::string &file_name, bool create) -> bool;
+
+  /** @brief Close the file. */
+  void Close();
+
+  /** @return true if the file is open */
+  auto IsOpen() const -> bool { return fd_ >= 0; }
+
+  /**
+   * @brief Record the size class of a page and make it durable.
+   * @param page_id id of the page, the first of its page ids
+   * @param size_class its size class, Size4K once the page is gone
+   */
+  void Write(page_id_t page_id, PageSizeClass size_class);
+
+  /** @return every page recorded with a size class other than Size4K, in page id order */
+  auto ReadAll() -> std::vector<std::pair<page_id_t, PageSizeClass>>;
+
+ private:
+  int fd_{-1};
+};
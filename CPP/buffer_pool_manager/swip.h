@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "page.h"
+
+/**
+ * Swip is a 64-bit page reference stored inside page data, such as a child pointer of an index node. It holds
+ * either the id of the referenced page or, once the buffer pool has swizzled it, a direct pointer to the frame
+ * holding that page, so that following it skips the page table.
+ *
+ * The low bit tells the two apart: a swizzled swip is the Page pointer with the low bit set, an unswizzled one is
+ * (page id + 1) shifted left by one, so an all-zero swip is INVALID_PAGE_ID and a freshly zeroed page needs no
+ * initialization. Swips are only ever unswizzled on disk. A swip has to be 8-byte aligned within the page, it is
+ * read and written atomically because readers follow it while the buffer pool may swizzle it.
+ */
+class Swip {
+ public:
+  explicit Swip(page_id_t page_id = INVALID_PAGE_ID) : value_(Encode(page_id)) {}
+
+  /** @return true if the swip holds a frame pointer */
+  auto IsSwizzled() const -> bool { return IsSwizzled(value_.load(std::memory_order_acquire)); }
+
+  /** @return the id of the referenced page, whether the swip is swizzled or not */
+  auto GetPageId() const -> page_id_t {
+    uint64_t value = value_.load(std::memory_order_acquire);
+    return IsSwizzled(value) ? PageOf(value)->GetPageId() : PageIdOf(value);
+  }
+
+  /**
+   * Point the swip to a page. Only valid on a swip that is not swizzled, see BufferPoolManager::UnswizzleSwip.
+   * @param page_id id of the page
+   */
+  void SetPageId(page_id_t page_id) { value_.store(Encode(page_id), std::memory_order_release); }
+
+ private:
+  friend class BufferPoolManager;
+
+  static auto IsSwizzled(uint64_t value) -> bool { return (value & 1) != 0; }
+
+  static auto Encode(page_id_t page_id) -> uint64_t {
+    return static_cast<uint64_t>(static_cast<uint32_t>(page_id) + 1U) << 1;
+  }
+
+  static auto Encode(Page *page) -> uint64_t { return reinterpret_cast<uintptr_t>(page) | 1; }
+
+  static auto PageIdOf(uint64_t value) -> page_id_t {
+    return static_cast<page_id_t>(static_cast<uint32_t>(value >> 1) - 1U);
+  }
+
+  static auto PageOf(uint64_t value) -> Page * { return reinterpret_cast<Page *>(value & ~uint64_t{1}); }
+
+  std::atomic<uint64_t> value_;
+};
+
+static_assert(sizeof(Swip) == sizeof(uint64_t));
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
@@ -0,0 +1,84 @@
+#include "thread_pin_cache.h"
+
+auto ThreadPinCache::Take(uint64_t pool, page_id_t page_id) -> Page * {
+  std::scoped_lock scoped_lock(latch_);
+  for (auto &entry : entries_) {
+    if (entry.pool_ == pool && entry.page_id_ == page_id) {
+      Page *page = entry.page_;
+      entry.pins_ -= 1;
+      entry.last_used_ = ++tick_;
+      if (entry.pins_ == 0) {
+        entry = Entry{};
+      }
+      return page;
+    }
+  }
+  return nullptr;
+}
+
+auto ThreadPinCache::Park(uint64_t pool, page_id_t page_id, Page *page, size_t max_entries, Entry *evicted) -> bool {
+  std::scoped_lock scoped_lock(latch_);
+  Entry *free_entry = nullptr;
+  Entry *pool_victim = nullptr;
+  Entry *any_victim = nullptr;
+  size_t pool_entries = 0;
+  for (auto &entry : entries_) {
+    if (entry.pool_ == pool && entry.page_id_ == page_id) {
+      entry.pins_ += 1;
+      entry.last_used_ = ++tick_;
+      return false;
+    }
+    if (entry.pool_ == 0) {
+      if (free_entry == nullptr) {
+        free_entry = &entry;
+      }
+      continue;
+    }
+    if (entry.pool_ == pool) {
+      pool_entries += 1;
+      if (pool_victim == nullptr || entry.last_used_ < pool_victim->last_used_) {
+        pool_victim = &entry;
+      }
+    }
+    if (any_victim == nullptr || entry.last_used_ < any_victim->last_used_) {
+      any_victim = &entry;
+    }
+  }
+
+  Entry *target = free_entry;
+  if (pool_entries >= max_entries && pool_victim != nullptr) {
+    target = pool_victim;
+  } else if (target == nullptr) {
+    target = any_victim;
+  }
+  bool evict = target->pool_ != 0;
+  if (evict) {
+    *evicted = *target;
+  }
+  *target = Entry{pool, page_id, page, 1, ++tick_};
+  return evict;
+}
+
+auto ThreadPinCache::Remove(uint64_t pool, page_id_t page_id) -> std::vector<Entry> {
+  std::scoped_lock scoped_lock(latch_);
+  std::vector<Entry> removed;
+  for (auto &entry : entries_) {
+    if (entry.pool_ == pool && (page_id == INVALID_PAGE_ID || entry.page_id_ == page_id)) {
+      removed.push_back(entry);
+      entry = Entry{};
+    }
+  }
+  return removed;
+}
+
+auto ThreadPinCache::RemoveAll() -> std::vector<Entry> {
+  std::scoped_lock scoped_lock(latch_);
+  std::vector<Entry> removed;
+  for (auto &entry : entries_) {
+    if (entry.pool_ != 0) {
+      removed.push_back(entry);
+      entry = Entry{};
+    }
+  }
+  return removed;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "page.h"
+
+/**
+ * ThreadPinCache is a tiny table of pins one thread has deferred releasing, see
+ * BufferPoolManager::EnableThreadPinCache.
+ *
+ * Each entry holds some pins of one page of one buffer pool, identified by the pool's serial number since a
+ * thread may use several pools. Unpinning parks the pin in the table instead of releasing it, and fetching the
+ * page again takes the parked pin back without touching the pool. The table is small enough that a linear scan
+ * beats anything cleverer. Every thread has its own, and its latch is only contended when another thread drains
+ * the pins of a pool.
+ */
+class ThreadPinCache {
+ public:
+  /** Pins of one page parked in the table. */
+  struct Entry {
+    /** Serial number of the pool the page belongs to, 0 for a free entry. */
+    uint64_t pool_{0};
+    page_id_t page_id_{INVALID_PAGE_ID};
+    Page *page_{nullptr};
+    uint32_t pins_{0};
+    /** Tick of the last Park or Take, for least-recently-used eviction. */
+    uint64_t last_used_{0};
+  };
+
+  /**
+   * @brief Take back one parked pin of a page.
+   * @param pool serial number of the pool
+   * @param page_id id of the page
+   * @return the pinned page, or nullptr if no pin of it is parked
+   */
+  auto Take(uint64_t pool, page_id_t page_id) -> Page *;
+
+  /**
+   * @brief Park one pin of a page. If the table is out of room, the least recently used entry is evicted to make
+   * some: the pool's own, once it has max_entries entries, otherwise any.
+   * @param pool serial number of the pool
+   * @param page_id id of the page
+   * @param page the pinned page
+   * @param max_entries most entries the pool may have in the table, at most MAX_ENTRIES
+   * @param[out] evicted the evicted entry, whose pins the caller has to release
+   * @return true if an entry was evicted
+   */
+  auto Park(uint64_t pool, page_id_t page_id, Page *page, size_t max_entries, Entry *evicted) -> bool;
+
+  /**
+   * @brief Remove the entries of a pool.
+   * @param pool serial number of the pool
+   * @param page_id only remove the entry of this page, or all of them for INVALID_PAGE_ID
+   * @return the removed entries, whose pins the caller has to release
+   */
+  auto Remove(uint64_t pool, page_id_t page_id = INVALID_PAGE_ID) -> std::vector<Entry>;
+
+  /** @return every entry of the table, emptying it */
+  auto RemoveAll() -> std::vector<Entry>;
+
+  /** Size of the table. */
+  static constexpr size_t MAX_ENTRIES = 16;
+
+ private:
+  Entry entries_[MAX_ENTRIES];
+  uint64_t tick_{0};
+  std::mutex latch_;
+};
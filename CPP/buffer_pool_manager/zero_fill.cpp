@@ -0,0 +1,46 @@
+#include "zero_fill.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__)
+
+void ZeroFill::Streaming(char *data, size_t size) {
+  // Streaming stores need 16-byte alignment, fill any unaligned head and tail with ordinary stores
+  size_t head = (16 - reinterpret_cast<uintptr_t>(data) % 16) % 16;
+  if (head >= size) {
+    memset(data, 0, size);
+    return;
+  }
+  memset(data, 0, head);
+  data += head;
+  size -= head;
+
+  const __m128i zero = _mm_setzero_si128();
+  auto *out = reinterpret_cast<__m128i *>(data);
+  size_t blocks = size / 16;
+  size_t i = 0;
+  // Four stores per iteration fill a whole cache line, letting the write-combining buffer flush it in one go
+  for (; i + 4 <= blocks; i += 4) {
+    _mm_stream_si128(out + i, zero);
+    _mm_stream_si128(out + i + 1, zero);
+    _mm_stream_si128(out + i + 2, zero);
+    _mm_stream_si128(out + i + 3, zero);
+  }
+  for (; i < blocks; ++i) {
+    _mm_stream_si128(out + i, zero);
+  }
+  memset(data + blocks * 16, 0, size % 16);
+  // Non-temporal stores are weakly ordered, unlike every other store
+  _mm_sfence();
+}
+
+#else
+
+void ZeroFill::Streaming(char *data, size_t size) { memset(data, 0, size); }
+
+#endif
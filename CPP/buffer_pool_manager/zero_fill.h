@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Zeroing of page buffers.
+ *
+ * Streaming zeroes a buffer with non-temporal stores, which write straight to memory instead of first reading
+ * every cache line into the cache. Zeroing a page that is not about to be read keeps it from displacing the hot
+ * pages' lines, which matters when pages are allocated in bulk, e.g. during a bulk load. Uses SSE2 streaming
+ * stores on x86-64 and falls back to memset elsewhere.
+ */
+class ZeroFill {
+ public:
+  /**
+   * @brief Zero a buffer with non-temporal stores. The stores are fenced before returning, so the zeroes are
+   * ordered before anything that later publishes the buffer to other threads.
+   * @param data start of the buffer
+   * @param size number of bytes
+   */
+  static void Streaming(char *data, size_t size);
+};